@@ -27,7 +27,7 @@ then
 fi
 
 # 编译可执行文件
-g++ -g -Wall ../src/hyphen-build/hyphen_pattern_processor.cpp -o transform
+g++ -g -Wall ../src/hyphen-build/hyphen_pattern_processor.cpp -o transform -lz
 
 # 读取 JSON 文件并遍历数组，获取每个对象的 language 字段
 jq -c '.[]' "$JSON_FILE" | while read -r item; do
@@ -12,6 +12,7 @@
 # WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 # See the License for the specific language governing permissions and
 # limitations under the License.
+import json
 import sys
 import subprocess
 import os
@@ -22,6 +23,21 @@ def run_command(command):
     return result.stdout, result.stderr, result.returncode
 
 
+# patterns lost while building show up in the stats written next to the hpb file
+def report_pattern_loss(tex_file_path, output_dir):
+    language = os.path.splitext(os.path.basename(tex_file_path))[0]
+    stats_path = os.path.join(output_dir, language + ".stats.json")
+    if not os.path.exists(stats_path):
+        return
+    with open(stats_path, "r") as stats_file:
+        stats = json.load(stats_file)
+    if stats["dropped_patterns"] != 0:
+        print(f"Warning: {language} lost {stats['dropped_patterns']} patterns in {stats['dropped_nodes']} nodes "
+              "that did not fit the offsets")
+    if stats["conflicting_duplicates"] != 0:
+        print(f"Warning: {language} redefines {stats['conflicting_duplicates']} patterns with other levels")
+
+
 def main():
     if len(sys.argv) != 4:
         print("Usage: python generate_hpb.py <hpb_transform_exe> <tex_file_path> <output_hpb_file>")
@@ -38,14 +54,15 @@ def main():
         print(f"Created directory: {output_dir}")
 
     # 创建命令
-    command_str = f"{hpb_transform_exe} {tex_file_path} {output_hpb_file}"
-    command = [hpb_transform_exe, tex_file_path, output_hpb_file]
+    command_str = f"{hpb_transform_exe} --stats {tex_file_path} {output_hpb_file}"
+    command = [hpb_transform_exe, "--stats", tex_file_path, output_hpb_file]
     print(f"hpy_command: {command_str}")
 
     # 执行命令
     stdout, stderr, returncode = run_command(command)
     if returncode == 0:
         print("Command executed successfully.")
+        report_pattern_loss(tex_file_path, output_hpb_file)
     else:
         print(f"Command failed with return code {returncode}")
         print(f"Error output: {stderr.decode('utf-8')}")
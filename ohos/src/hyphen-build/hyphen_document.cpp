@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hyphen_document.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <unicode/uchar.h>
+#include <unicode/utf16.h>
+#include <unicode/utf8.h>
+
+using namespace std;
+
+namespace OHOS::Hyphenate {
+namespace {
+constexpr size_t CHUNKS_PER_THREAD = 8;
+constexpr size_t MIN_CHUNK_UNITS = 4096;
+constexpr size_t MAX_CHUNK_UNITS = 0x10000;
+constexpr size_t MASK_BITS = 64;
+constexpr UChar32 REPLACEMENT_CHAR = 0xfffd;
+
+bool IsWordCode(UChar32 code)
+{
+    return u_isalpha(code) || (U_GET_GC_MASK(code) & U_GC_M_MASK) != 0;
+}
+
+// true if the code point starting at position belongs to a word
+bool IsWordAt(const uint16_t* text, size_t position, size_t length)
+{
+    UChar32 code = 0;
+    U16_NEXT(text, position, length, code);
+    return IsWordCode(code);
+}
+} // namespace
+
+HyphenDocumentHyphenator::HyphenDocumentHyphenator(std::shared_ptr<const HyphenDictionary> dictionary,
+                                                   size_t threads, const HyphenBreakOptions& options)
+    : fDictionary(std::move(dictionary)), fOptions(options)
+{
+    if (threads == 0) {
+        threads = max<size_t>(thread::hardware_concurrency(), 1);
+    }
+    for (size_t i = 0; i < threads; i++) {
+        fQueues.push_back(make_unique<Queue>());
+    }
+    for (size_t i = 0; i + 1 < threads; i++) {
+        fWorkers.emplace_back(&HyphenDocumentHyphenator::WorkerLoop, this, i);
+    }
+}
+
+HyphenDocumentHyphenator::~HyphenDocumentHyphenator()
+{
+    {
+        lock_guard<mutex> lock(fJobLock);
+        fStop = true;
+    }
+    fJobReady.notify_all();
+    for (auto& worker : fWorkers) {
+        worker.join();
+    }
+}
+
+void HyphenDocumentHyphenator::WorkerLoop(size_t worker)
+{
+    uint64_t generation = 0;
+    while (true) {
+        {
+            unique_lock<mutex> lock(fJobLock);
+            fJobReady.wait(lock, [this, generation] { return fStop || fGeneration != generation; });
+            if (fStop) {
+                return;
+            }
+            generation = fGeneration;
+        }
+        RunQueues(worker);
+    }
+}
+
+bool HyphenDocumentHyphenator::NextChunk(size_t worker, size_t& chunk)
+{
+    {
+        auto& own = *fQueues[worker];
+        lock_guard<mutex> lock(own.lock);
+        if (!own.chunks.empty()) {
+            chunk = own.chunks.front();
+            own.chunks.pop_front();
+            return true;
+        }
+    }
+    // steal from the far end, the owner keeps working on the text next to its position
+    for (size_t i = 1; i < fQueues.size(); i++) {
+        auto& victim = *fQueues[(worker + i) % fQueues.size()];
+        lock_guard<mutex> lock(victim.lock);
+        if (!victim.chunks.empty()) {
+            chunk = victim.chunks.back();
+            victim.chunks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void HyphenDocumentHyphenator::RunQueues(size_t worker)
+{
+    size_t chunk = 0;
+    while (NextChunk(worker, chunk)) {
+        if (fPhase == Phase::HYPHENATE) {
+            HyphenateChunk(fChunks[chunk]);
+        } else {
+            CopyChunk(fChunks[chunk]);
+        }
+        if (fRemaining.fetch_sub(1) == 1) {
+            lock_guard<mutex> lock(fJobLock);
+            fJobDone.notify_all();
+        }
+    }
+}
+
+void HyphenDocumentHyphenator::RunPhase(Phase phase)
+{
+    fPhase = phase;
+    fRemaining = fChunks.size();
+    // contiguous runs of chunks, so that each thread mostly walks its own part of the text
+    size_t perQueue = (fChunks.size() + fQueues.size() - 1) / fQueues.size();
+    for (size_t i = 0; i < fQueues.size(); i++) {
+        lock_guard<mutex> lock(fQueues[i]->lock);
+        for (size_t chunk = i * perQueue; chunk < min((i + 1) * perQueue, fChunks.size()); chunk++) {
+            fQueues[i]->chunks.push_back(chunk);
+        }
+    }
+    {
+        lock_guard<mutex> lock(fJobLock);
+        fGeneration++;
+    }
+    fJobReady.notify_all();
+    RunQueues(fQueues.size() - 1);
+    unique_lock<mutex> lock(fJobLock);
+    fJobDone.wait(lock, [this] { return fRemaining == 0; });
+}
+
+void HyphenDocumentHyphenator::SplitChunks(size_t length)
+{
+    size_t chunkUnits = length / (fQueues.size() * CHUNKS_PER_THREAD);
+    chunkUnits = min(max(chunkUnits, MIN_CHUNK_UNITS), MAX_CHUNK_UNITS);
+    fChunks.clear();
+    size_t start = 0;
+    while (start < length) {
+        size_t end = min(start + chunkUnits, length);
+        // move the cut behind the word (and surrogate pair) it falls into
+        while (end < length && (U16_IS_TRAIL(fText[end]) || IsWordAt(fText, end, length))) {
+            end++;
+        }
+        fChunks.emplace_back();
+        fChunks.back().start = start;
+        fChunks.back().end = end;
+        start = end;
+    }
+}
+
+void HyphenDocumentHyphenator::HyphenateChunk(Chunk& chunk)
+{
+    vector<vector<uint16_t>> targets;
+    vector<size_t> lookups; // words that are long enough to be broken
+    size_t position = chunk.start;
+    while (position < chunk.end) {
+        size_t start = position;
+        UChar32 code = 0;
+        U16_NEXT(fText, position, chunk.end, code);
+        if (!IsWordCode(code)) {
+            continue;
+        }
+        size_t next = position;
+        while (next < chunk.end) {
+            U16_NEXT(fText, next, chunk.end, code);
+            if (!IsWordCode(code)) {
+                break;
+            }
+            position = next;
+        }
+        HyphenDocumentWord word;
+        word.start = static_cast<uint32_t>(start);
+        word.length = static_cast<uint32_t>(position - start);
+        if (word.length >= fOptions.leftMin + fOptions.rightMin) {
+            lookups.push_back(chunk.words.size());
+            targets.push_back(GetInputWord(fText + start, word.length));
+        }
+        chunk.words.push_back(word);
+    }
+
+    HyphenBreakMasks masks;
+    if (!targets.empty() && fDictionary->HyphenateMasks(targets, masks, fOptions) != SUCCEED) {
+        fFailed = true;
+        return;
+    }
+    for (size_t i = 0; i < lookups.size(); i++) {
+        auto& word = chunk.words[lookups[i]];
+        word.firstBreak = static_cast<uint32_t>(chunk.breaks.size());
+        const uint64_t* mask = masks.Mask(i);
+        for (size_t k = 1; k < word.length; k++) {
+            // never split a surrogate pair
+            if (((mask[k / MASK_BITS] >> (k % MASK_BITS)) & 1) != 0 && !U16_IS_TRAIL(fText[word.start + k])) {
+                chunk.breaks.push_back(static_cast<uint32_t>(word.start + k));
+            }
+        }
+        word.breakCount = static_cast<uint32_t>(chunk.breaks.size()) - word.firstBreak;
+    }
+}
+
+void HyphenDocumentHyphenator::CopyChunk(const Chunk& chunk)
+{
+    auto words = fIndex->words.begin() + chunk.firstWord;
+    for (const auto& word : chunk.words) {
+        *words = word;
+        words->firstBreak = static_cast<uint32_t>(chunk.firstBreak + word.firstBreak);
+        if (fUnitOffsets != nullptr) {
+            words->start = fUnitOffsets[word.start];
+            words->length = fUnitOffsets[word.start + word.length] - fUnitOffsets[word.start];
+        }
+        ++words;
+    }
+    auto breaks = fIndex->breaks.begin() + chunk.firstBreak;
+    for (auto position : chunk.breaks) {
+        *breaks++ = fUnitOffsets != nullptr ? fUnitOffsets[position] : position;
+    }
+}
+
+int32_t HyphenDocumentHyphenator::Run(const uint16_t* text, size_t length, const uint32_t* unitOffsets,
+                                      HyphenDocumentIndex& index)
+{
+    index.words.clear();
+    index.breaks.clear();
+    if (fDictionary == nullptr) {
+        cerr << "no dictionary to hyphenate the document" << endl;
+        return FAILED;
+    }
+    fText = text;
+    fUnitOffsets = unitOffsets;
+    fIndex = &index;
+    fFailed = false;
+    SplitChunks(length);
+    RunPhase(Phase::HYPHENATE);
+
+    size_t wordCount = 0;
+    size_t breakCount = 0;
+    for (auto& chunk : fChunks) {
+        chunk.firstWord = wordCount;
+        chunk.firstBreak = breakCount;
+        wordCount += chunk.words.size();
+        breakCount += chunk.breaks.size();
+    }
+    if (!fFailed) {
+        // the whole index is allocated once, the chunks then fill in their parts in parallel
+        index.words.resize(wordCount);
+        index.breaks.resize(breakCount);
+        RunPhase(Phase::COPY);
+    }
+    fChunks.clear();
+    fText = nullptr;
+    fUnitOffsets = nullptr;
+    fIndex = nullptr;
+    return fFailed ? FAILED : SUCCEED;
+}
+
+int32_t HyphenDocumentHyphenator::Hyphenate(const uint16_t* text, size_t length, HyphenDocumentIndex& index)
+{
+    if (length > numeric_limits<uint32_t>::max()) {
+        cerr << "document too large: " << length << " code units" << endl;
+        return FAILED;
+    }
+    lock_guard<mutex> lock(fCallLock);
+    return Run(text, length, nullptr, index);
+}
+
+int32_t HyphenDocumentHyphenator::Hyphenate(const std::string& utf8Text, HyphenDocumentIndex& index)
+{
+    if (utf8Text.size() >= numeric_limits<uint32_t>::max()) {
+        cerr << "document too large: " << utf8Text.size() << " bytes" << endl;
+        return FAILED;
+    }
+    vector<uint16_t> text;
+    vector<uint32_t> unitOffsets; // byte offset of every UTF-16 code unit, plus the end
+    text.reserve(utf8Text.size());
+    unitOffsets.reserve(utf8Text.size() + 1);
+    auto bytes = reinterpret_cast<const uint8_t*>(utf8Text.data());
+    int64_t length = static_cast<int64_t>(utf8Text.size());
+    int64_t position = 0;
+    while (position < length) {
+        uint32_t start = static_cast<uint32_t>(position);
+        UChar32 code = 0;
+        U8_NEXT(bytes, position, length, code);
+        if (code < 0) {
+            code = REPLACEMENT_CHAR;
+        }
+        if (U_IS_SUPPLEMENTARY(code)) {
+            text.push_back(U16_LEAD(code));
+            text.push_back(U16_TRAIL(code));
+            unitOffsets.push_back(start);
+        } else {
+            text.push_back(static_cast<uint16_t>(code));
+        }
+        unitOffsets.push_back(start);
+    }
+    unitOffsets.push_back(static_cast<uint32_t>(utf8Text.size()));
+    lock_guard<mutex> lock(fCallLock);
+    return Run(text.data(), text.size(), unitOffsets.data(), index);
+}
+} // namespace OHOS::Hyphenate
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HYPHENATE_DOCUMENT_H
+#define HYPHENATE_DOCUMENT_H
+
+#include "hyphen_pattern.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace OHOS::Hyphenate {
+// A word of the document, offsets in code units of the input (bytes for UTF-8)
+struct HyphenDocumentWord {
+    uint32_t start{0};
+    uint32_t length{0};
+    uint32_t firstBreak{0}; // into HyphenDocumentIndex::breaks
+    uint32_t breakCount{0};
+};
+
+// Words of a document in text order and the offsets a hyphen may be inserted before
+struct HyphenDocumentIndex {
+    std::vector<HyphenDocumentWord> words;
+    std::vector<uint32_t> breaks;
+};
+
+// Hyphenates whole documents on a pool of worker threads sharing one dictionary.
+// The text is cut into chunks at word boundaries, every worker starts with a
+// contiguous run of chunks and steals from the others once its own run is done.
+// Words are runs of letters and combining marks, everything else separates them.
+class HyphenDocumentHyphenator {
+public:
+    // threads == 0 uses one worker per core, the calling thread always takes part
+    explicit HyphenDocumentHyphenator(std::shared_ptr<const HyphenDictionary> dictionary, size_t threads = 0,
+                                      const HyphenBreakOptions& options = {});
+    ~HyphenDocumentHyphenator();
+    HyphenDocumentHyphenator(const HyphenDocumentHyphenator&) = delete;
+    HyphenDocumentHyphenator& operator=(const HyphenDocumentHyphenator&) = delete;
+
+    size_t ThreadCount() const
+    {
+        return fWorkers.size() + 1;
+    }
+    // documents up to 4G code units, calls from several threads are served one after another
+    int32_t Hyphenate(const uint16_t* text, size_t length, HyphenDocumentIndex& index);
+    int32_t Hyphenate(const std::string& utf8Text, HyphenDocumentIndex& index);
+
+private:
+    struct Chunk {
+        size_t start{0};
+        size_t end{0};
+        std::vector<HyphenDocumentWord> words; // breaks relative to the chunk
+        std::vector<uint32_t> breaks;
+        size_t firstWord{0}; // position in the index
+        size_t firstBreak{0};
+    };
+    struct Queue {
+        std::mutex lock;
+        std::deque<size_t> chunks;
+    };
+    enum class Phase { HYPHENATE, COPY };
+
+    int32_t Run(const uint16_t* text, size_t length, const uint32_t* unitOffsets, HyphenDocumentIndex& index);
+    void WorkerLoop(size_t worker);
+    void RunQueues(size_t worker);
+    bool NextChunk(size_t worker, size_t& chunk);
+    void HyphenateChunk(Chunk& chunk);
+    void CopyChunk(const Chunk& chunk);
+    void RunPhase(Phase phase);
+    void SplitChunks(size_t length);
+
+    std::shared_ptr<const HyphenDictionary> fDictionary;
+    HyphenBreakOptions fOptions;
+    std::vector<std::thread> fWorkers;
+    std::vector<std::unique_ptr<Queue>> fQueues; // one per worker, the last one of the calling thread
+
+    // state of the current document
+    std::mutex fCallLock;
+    const uint16_t* fText{nullptr};
+    const uint32_t* fUnitOffsets{nullptr}; // UTF-16 unit to UTF-8 byte offset, nullptr for UTF-16 input
+    HyphenDocumentIndex* fIndex{nullptr};
+    std::vector<Chunk> fChunks;
+    Phase fPhase{Phase::HYPHENATE};
+    std::atomic<size_t> fRemaining{0};
+    std::atomic<bool> fFailed{false};
+
+    std::mutex fJobLock;
+    std::condition_variable fJobReady;
+    std::condition_variable fJobDone;
+    uint64_t fGeneration{0};
+    bool fStop{false};
+};
+} // namespace OHOS::Hyphenate
+#endif
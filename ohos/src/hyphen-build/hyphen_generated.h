@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HYPHENATE_GENERATED_H
+#define HYPHENATE_GENERATED_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace OHOS::Hyphenate {
+// Matcher compiled from a pattern set by hpb_transform --emit-cpp, the patterns are
+// nested switch statements over the code units with the levels inlined. It takes a
+// word in the reader form (see GetInputWord) and raises result[0..length) to the
+// levels HyphenDictionary::Hyphenate produces for the same patterns.
+using HyphenGeneratedMatcher = void (*)(const uint16_t* target, size_t length, uint8_t* result);
+
+struct HyphenGeneratedLanguage {
+    const char* language;
+    HyphenGeneratedMatcher matcher;
+};
+
+// matcher of e.g. "hyph-en-us", nullptr if the language was not compiled in
+HyphenGeneratedMatcher FindGeneratedMatcher(const std::string& language);
+
+inline void RaiseLevel(uint8_t& level, uint8_t value)
+{
+    if (value > level) {
+        level = value;
+    }
+}
+
+inline void HyphenateGenerated(HyphenGeneratedMatcher matcher, const std::vector<uint16_t>& utf16Target,
+                               std::vector<uint8_t>& result)
+{
+    result.assign(utf16Target.size(), 0);
+    matcher(utf16Target.data(), utf16Target.size(), result.data());
+}
+} // namespace OHOS::Hyphenate
+#endif
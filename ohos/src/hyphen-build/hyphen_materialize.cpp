@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hyphen_materialize.h"
+
+#include "hyphen_pattern.h"
+
+#include <cstring>
+#include <unicode/utf16.h>
+#include <unicode/utf8.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace OHOS::Hyphenate {
+namespace {
+constexpr size_t BLOCK_BYTES = 16;
+constexpr size_t MASK_BITS = 64;
+
+// Runs between breaks are mostly a few code units, these are moved as one unaligned
+// 16 byte block when the block stays within both texts. The bytes copied past the
+// run are overwritten by the following writes.
+inline void CopyRun(uint8_t* dst, const uint8_t* src, size_t bytes, const uint8_t* dstEnd, const uint8_t* srcEnd)
+{
+    if (bytes <= BLOCK_BYTES && dst + BLOCK_BYTES <= dstEnd && src + BLOCK_BYTES <= srcEnd) {
+#if defined(__SSE2__)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+#elif defined(__ARM_NEON)
+        vst1q_u8(dst, vld1q_u8(src));
+#else
+        memcpy(dst, src, BLOCK_BYTES);
+#endif
+        return;
+    }
+    memcpy(dst, src, bytes);
+}
+
+size_t EncodeHyphen(uint32_t hyphen, uint16_t* units)
+{
+    size_t length = 0;
+    U16_APPEND_UNSAFE(units, length, hyphen);
+    return length;
+}
+
+size_t EncodeHyphen(uint32_t hyphen, char* units)
+{
+    size_t length = 0;
+    U8_APPEND_UNSAFE(reinterpret_cast<uint8_t*>(units), length, hyphen);
+    return length;
+}
+
+// nextBreak returns the breaks one by one, breakCount of them
+template <typename Unit, typename NextBreak>
+int32_t WriteRuns(const Unit* text, size_t length, size_t breakCount, NextBreak&& nextBreak, Unit* out,
+                  size_t capacity, size_t& written, uint32_t hyphen)
+{
+    Unit units[U8_MAX_LENGTH];
+    size_t hyphenLength = EncodeHyphen(hyphen, units);
+    size_t total = length + breakCount * hyphenLength;
+    written = 0;
+    if (total > capacity) {
+        return FAILED;
+    }
+    const uint8_t* srcEnd = reinterpret_cast<const uint8_t*>(text + length);
+    const uint8_t* dstEnd = reinterpret_cast<const uint8_t*>(out + total);
+    Unit* cursor = out;
+    size_t position = 0;
+    for (size_t i = 0; i < breakCount; i++) {
+        size_t next = nextBreak();
+        if (next < position || next > length) {
+            return FAILED;
+        }
+        size_t run = next - position;
+        CopyRun(reinterpret_cast<uint8_t*>(cursor), reinterpret_cast<const uint8_t*>(text + position),
+                run * sizeof(Unit), dstEnd, srcEnd);
+        cursor += run;
+        for (size_t j = 0; j < hyphenLength; j++) {
+            *cursor++ = units[j];
+        }
+        position = next;
+    }
+    CopyRun(reinterpret_cast<uint8_t*>(cursor), reinterpret_cast<const uint8_t*>(text + position),
+            (length - position) * sizeof(Unit), dstEnd, srcEnd);
+    written = total;
+    return SUCCEED;
+}
+
+// bits of the mask below length, the positions a word can have breaks at
+size_t MaskBreakCount(size_t length, const uint64_t* mask)
+{
+    size_t count = 0;
+    for (size_t base = 0; base < length; base += MASK_BITS) {
+        uint64_t bits = mask[base / MASK_BITS];
+        if (length - base < MASK_BITS) {
+            bits &= (1ULL << (length - base)) - 1;
+        }
+        count += static_cast<size_t>(__builtin_popcountll(bits));
+    }
+    return count;
+}
+} // namespace
+
+size_t HyphenatedSizeUtf16(size_t length, size_t breakCount, uint32_t hyphen)
+{
+    return length + breakCount * U16_LENGTH(hyphen);
+}
+
+size_t HyphenatedSizeUtf8(size_t length, size_t breakCount, uint32_t hyphen)
+{
+    return length + breakCount * U8_LENGTH(hyphen);
+}
+
+int32_t WriteHyphenatedUtf16(const uint16_t* text, size_t length, const uint32_t* breaks, size_t breakCount,
+                             uint16_t* out, size_t capacity, size_t& written, uint32_t hyphen)
+{
+    size_t index = 0;
+    return WriteRuns(text, length, breakCount, [breaks, &index]() { return breaks[index++]; }, out, capacity,
+                     written, hyphen);
+}
+
+int32_t WriteHyphenatedUtf8(const char* text, size_t length, const uint32_t* breaks, size_t breakCount, char* out,
+                            size_t capacity, size_t& written, uint32_t hyphen)
+{
+    size_t index = 0;
+    return WriteRuns(text, length, breakCount, [breaks, &index]() { return breaks[index++]; }, out, capacity,
+                     written, hyphen);
+}
+
+size_t HyphenatedWordSize(size_t length, const uint64_t* mask, uint32_t hyphen)
+{
+    return HyphenatedSizeUtf16(length, MaskBreakCount(length, mask), hyphen);
+}
+
+int32_t WriteHyphenatedWord(const uint16_t* word, size_t length, const uint64_t* mask, uint16_t* out,
+                            size_t capacity, size_t& written, uint32_t hyphen)
+{
+    size_t base = 0;
+    uint64_t bits = length == 0 ? 0 : mask[0];
+    auto nextBreak = [mask, &base, &bits]() {
+        while (bits == 0) {
+            base += MASK_BITS;
+            bits = mask[base / MASK_BITS];
+        }
+        size_t position = base + static_cast<size_t>(__builtin_ctzll(bits));
+        bits &= bits - 1;
+        return position;
+    };
+    return WriteRuns(word, length, MaskBreakCount(length, mask), nextBreak, out, capacity, written, hyphen);
+}
+} // namespace OHOS::Hyphenate
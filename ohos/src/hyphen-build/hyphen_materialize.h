@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HYPHENATE_MATERIALIZE_H
+#define HYPHENATE_MATERIALIZE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace OHOS::Hyphenate {
+constexpr uint32_t SOFT_HYPHEN = 0x00ad;
+
+// Hyphenated copies of text written to caller buffers. A hyphen (U+00AD by default,
+// any code point can be used) is inserted before every offset of breaks, which are
+// ascending offsets in code units of the text, as HyphenTextPipeline and
+// HyphenDocumentHyphenator report them. The size functions give the exact amount of
+// code units the copy takes, writing fails if the buffer is smaller or a break is
+// out of order.
+size_t HyphenatedSizeUtf16(size_t length, size_t breakCount, uint32_t hyphen = SOFT_HYPHEN);
+size_t HyphenatedSizeUtf8(size_t length, size_t breakCount, uint32_t hyphen = SOFT_HYPHEN);
+
+int32_t WriteHyphenatedUtf16(const uint16_t* text, size_t length, const uint32_t* breaks, size_t breakCount,
+                             uint16_t* out, size_t capacity, size_t& written, uint32_t hyphen = SOFT_HYPHEN);
+int32_t WriteHyphenatedUtf8(const char* text, size_t length, const uint32_t* breaks, size_t breakCount, char* out,
+                            size_t capacity, size_t& written, uint32_t hyphen = SOFT_HYPHEN);
+
+// Single word with the breaks of its mask, see HyphenBreakMasks::Mask
+size_t HyphenatedWordSize(size_t length, const uint64_t* mask, uint32_t hyphen = SOFT_HYPHEN);
+int32_t WriteHyphenatedWord(const uint16_t* word, size_t length, const uint64_t* mask, uint16_t* out,
+                            size_t capacity, size_t& written, uint32_t hyphen = SOFT_HYPHEN);
+} // namespace OHOS::Hyphenate
+#endif
@@ -15,8 +15,15 @@
 #ifndef HYPHENATE_PATTERN_H
 #define HYPHENATE_PATTERN_H
 
+#include <atomic>
 #include <cinttypes>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace OHOS::Hyphenate {
@@ -33,9 +40,143 @@ constexpr size_t SHIFT_BITS_14 = 14;
 constexpr size_t SHIFT_BITS_16 = 16;
 constexpr size_t SHIFT_BITS_30 = 30;
 constexpr size_t PADDING_SIZE = 4;
+constexpr size_t NIBBLE_PADDING_SIZE = 8;
+constexpr size_t SHIFT_BITS_FLAGS = 16;
+constexpr uint32_t BINARY_VERSION = 0x2;
+constexpr uint32_t BINARY_VERSION_FLAGS = 0x3;
+// Feature flags stored in bits 16..23 of the header version word
+constexpr uint8_t HYPHEN_FLAG_NIBBLE_RULES = 0x01;
+// PAIRS nodes may be in access frequency order, marked by PAIRS_FREQUENCY_ORDER in their count
+constexpr uint8_t HYPHEN_FLAG_FREQUENCY_PAIRS = 0x02;
+constexpr uint16_t PAIRS_FREQUENCY_ORDER = 0x8000;
+// a HyphenCodeFilter follows the mappings
+constexpr uint8_t HYPHEN_FLAG_CODE_FILTER = 0x04;
+// LINEAR nodes may end in a branching node, their last segment count has LINEAR_CONTINUATION
+// set and the codes are followed by the node value to continue with instead of a rule
+constexpr uint8_t HYPHEN_FLAG_RADIX_EDGES = 0x08;
+constexpr uint16_t LINEAR_CONTINUATION = 0x8000;
 constexpr int16_t BREAK_FLAG = '9';
 constexpr int16_t NO_BREAK_FLAG = '8';
 
+constexpr uint8_t HYPHEN_MAGIC = 'H';
+constexpr uint8_t HYPHEN_MAGIC_AHO_CORASICK = 'A';
+constexpr uint32_t AHO_CORASICK_VERSION = 0x1;
+constexpr uint8_t HYPHEN_MAGIC_COMPRESSED = 'Z';
+constexpr uint32_t COMPRESSED_VERSION = 0x1;
+
+// Compressed container around a trie binary. The beginning of the original file
+// (header, rules and shared nodes) and its end (toc and mappings) are stored as is,
+// every top level subtree is deflated separately and expanded on first use.
+struct HzHeader {
+    uint8_t magic1;
+    uint8_t magic2;
+    uint16_t flags;
+    uint32_t originalSize;
+    uint32_t prefixSize;  // bytes stored as is from the beginning of the original
+    uint32_t tailOffset;  // original offset of the toc, stored as is until the end
+    uint32_t chunkCount;  // one chunk per toc entry
+    uint32_t chunks;      // HzChunk array
+    uint32_t version;
+};
+
+struct HzChunk {
+    uint32_t offset;     // position in the original file
+    uint32_t size;       // size in the original file, zero for empty entries
+    uint32_t compressed; // position of the deflated data in the container
+    uint32_t compressedSize;
+};
+
+constexpr uint8_t HYPHEN_MAGIC_BUNDLE = 'B';
+constexpr uint32_t BUNDLE_VERSION = 0x1;
+constexpr size_t BUNDLE_NAME_SIZE = 32;
+constexpr size_t RULE_ADDRESS_SPACE = 0x1000;
+
+// Several trie binaries in one file. The rules are addressed from the beginning of a
+// binary, so the languages of a rule group are built with the same rule table which is
+// stored once, the languages themselves are stored from the end of the rules onwards.
+struct HbHeader {
+    uint8_t magic1;
+    uint8_t magic2;
+    uint16_t flags;
+    uint32_t languageCount;
+    uint32_t languages;  // HbLanguage array
+    uint32_t groupCount; // amount of shared rule tables
+    uint32_t version;
+};
+
+struct HbLanguage {
+    char name[BUNDLE_NAME_SIZE]; // e.g. "hyph-en-us", zero terminated
+    uint32_t header[4];          // header of the original binary
+    uint32_t rules;              // rule table, laid out as the beginning of the original binary
+    uint32_t image;              // original binary from 'split' onwards
+    uint32_t split;              // end of the rules in the original binary
+    uint32_t size;               // size of the original binary
+};
+
+// Aho-Corasick variant of the binary, all offsets in bytes from the beginning of the file
+struct AcHeader {
+    uint8_t magic1;
+    uint8_t magic2;
+    uint16_t flags;
+    uint32_t stateCount;
+    uint32_t states;      // AcState array, state zero is the root
+    uint32_t edgeCodes;   // uint16_t codes, sorted per state
+    uint32_t edgeTargets; // uint32_t target state for each code
+    uint32_t rules;       // rule levels, referenced by AcState::rule
+    uint32_t version;
+};
+
+struct AcState {
+    uint32_t edges;      // index of the first edge
+    uint32_t fail;       // longest proper suffix that is also a state
+    uint32_t rule;       // offset of the levels from AcHeader::rules
+    uint32_t outputLink; // next state on the fail chain having a rule, zero if none
+    uint16_t edgeCount;
+    uint8_t depth;       // pattern length
+    uint8_t ruleCount;   // amount of levels, zero if the state has no rule
+};
+
+// Codes of the patterns of a trie binary, 4 byte aligned after the mappings. Bit (code - first)
+// of the alphabet is set for every code a pattern uses, the same bit of the ends for every code
+// a pattern ends with. The word delimiter is kept out of both, CODE_FILTER_DELIMITER_ENDS tells
+// if it ends a pattern. Words without any alphabet code and positions holding no end code are
+// skipped by the reader without touching the trie.
+constexpr uint16_t CODE_FILTER_DELIMITER_ENDS = 0x1;
+constexpr size_t MAX_CODE_FILTER_WORDS = 0x400;
+// '.' in reader form
+constexpr uint16_t HYPHEN_DELIMITER_CODE = '`';
+
+struct HyphenCodeFilter {
+    static constexpr uint32_t WORD_SHIFT = 5;
+    static constexpr uint32_t BIT_MASK = 0x1f;
+
+    uint16_t first;
+    uint16_t words; // 32 bit words per bitmap
+    uint16_t flags;
+    uint16_t reserved;
+    uint32_t bitmaps[2]; // dynamic, alphabet followed by ends
+
+    bool InRange(uint16_t code) const
+    {
+        return static_cast<uint16_t>(code - first) < (static_cast<uint32_t>(words) << WORD_SHIFT);
+    }
+    bool InAlphabet(uint16_t code) const
+    {
+        return InRange(code) && TestBit(0, static_cast<uint16_t>(code - first));
+    }
+    bool CanEnd(uint16_t code) const
+    {
+        if (code == HYPHEN_DELIMITER_CODE) {
+            return (flags & CODE_FILTER_DELIMITER_ENDS) != 0;
+        }
+        return InRange(code) && TestBit(words, static_cast<uint16_t>(code - first));
+    }
+    bool TestBit(size_t bitmap, uint16_t bit) const
+    {
+        return ((bitmaps[bitmap + (bit >> WORD_SHIFT)] >> (bit & BIT_MASK)) & 0x1) != 0;
+    }
+};
+
 // We make assumption that 14 bytes is enough to represent offset
 // so we get two first bits in the array for path type
 // we have two bytes on the offset arrays
@@ -48,16 +189,238 @@ enum class PathType : uint8_t {
 };
 
 std::vector<uint16_t> ConvertToUtf16(const std::string& utf8Str);
+// '.' delimited and lower cased form of a word, as expected by the reader
+std::vector<uint16_t> GetInputWord(const char* input, bool verbose = true);
+std::vector<uint16_t> GetInputWord(const uint16_t* utf16Word, size_t length);
+// same, reusing the storage of target
+void GetInputWord(const uint16_t* utf16Word, size_t length, std::vector<uint16_t>& target);
+
+struct HyphenBuildOptions {
+    // store two hyphenation levels per byte in the rule table
+    bool nibbleRules{false};
+    // write single child runs inside branching subtrees as radix edges, which only readers
+    // knowing HYPHEN_FLAG_RADIX_EDGES can read
+    bool radixEdges{false};
+    // compile the patterns into an Aho-Corasick automaton instead of the reversed trie
+    bool ahoCorasick{false};
+    // deflate each top level subtree separately, see HzHeader
+    bool compress{false};
+    // word list ("word" or "word count" per line) used to lay out the hot paths together
+    std::string corpus;
+    // write the layout of each file as <language>.stats.json next to it
+    bool stats{false};
+};
 
 class HyphenProcessor {
 public:
-    void Proccess(const std::string& filePath, const std::string& outFilePath) const;
+    HyphenProcessor() = default;
+    explicit HyphenProcessor(const HyphenBuildOptions& options) : fOptions(options) {}
+    int32_t Proccess(const std::string& filePath, const std::string& outFilePath) const;
+    // Write all the languages to a single bundle (HbHeader), languages whose rules fit in
+    // the same table share it
+    int32_t ProcessBundle(const std::vector<std::string>& filePaths, const std::string& bundlePath) const;
+    // Compile each language into C++ matcher source (see hyphen_generated.h) and a
+    // registry of the compiled languages
+    int32_t ProcessCodegen(const std::vector<std::string>& filePaths, const std::string& outDir) const;
+
+private:
+    HyphenBuildOptions fOptions;
+};
+
+// Dictionary binary held in memory, aligned and zero padded so that the reader uses it in
+// place like a mapped file, see HpbBuilder and HyphenDictionary::Open
+class HpbImage {
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    const uint8_t* Data() const
+    {
+        return fData.get();
+    }
+    size_t Size() const
+    {
+        return fSize;
+    }
+
+private:
+    friend class HpbBuilder;
+    struct Release {
+        void operator()(uint8_t* data) const
+        {
+            free(data);
+        }
+    };
+    HpbImage() = default;
+
+    std::unique_ptr<uint8_t, Release> fData;
+    size_t fSize{0};
+};
+
+// Compiles patterns to a dictionary image within the process, without files. Patterns are
+// given as in the \patterns section of a .tex file (e.g. "1ba", ".ab2c"), exceptions as in
+// the \hyphenation section (e.g. "ta-ble"). Every build keeps its state to itself, builders
+// can be used any number of times and from several threads at once. Compressed containers
+// and stats are for files only.
+class HpbBuilder {
+public:
+    HpbBuilder() = default;
+    explicit HpbBuilder(const HyphenBuildOptions& options) : fOptions(options) {}
+    // nullptr if the patterns cannot be compiled
+    std::shared_ptr<const HpbImage> Build(const std::vector<std::string>& patterns,
+                                          const std::vector<std::string>& exceptions = {}) const;
+
+private:
+    HyphenBuildOptions fOptions;
 };
 
 class HyphenReader {
 public:
     int32_t Read(const char* filePath, const std::vector<uint16_t>& utf16Target) const;
+    // Quiet variant for many words, the trie walks of the words are interleaved
+    // to hide the memory latency. Targets are expected in the same form as for Read.
+    int32_t ReadBatch(const char* filePath, const std::vector<std::vector<uint16_t>>& utf16Targets,
+                      std::vector<std::vector<uint8_t>>& results) const;
+};
+
+// Byte range of a dictionary file
+struct HyphenPageRange {
+    size_t offset{0};
+    size_t length{0};
+};
+
+struct HyphenOpenOptions {
+    // fault in the whole file while mapping it (MAP_POPULATE)
+    bool populate{false};
+    // ask the kernel to read ahead the whole file (MADV_WILLNEED)
+    bool willNeed{false};
+    // keep the header, toc and mapping sections resident (mlock)
+    bool lockMetadata{false};
+    // hot ranges recorded with RecordStartupProfile, faulted in on a background thread
+    std::vector<HyphenPageRange> startupProfile;
+    // keep a copy of the dictionary in the memory of every NUMA node, lookups use the copy
+    // of the node they run on; standalone dictionaries only, ignored on single node hosts
+    bool replicatePerNode{false};
+};
+
+struct HyphenBreakOptions {
+    // shortest fragments allowed before and after a break, in code units
+    size_t leftMin{2};
+    size_t rightMin{3};
 };
 
+// Legal break positions of a list of words. Bit k of a word's mask allows a break
+// before code unit k of the word, not counting the '.' delimiters of the reader form.
+// Words longer than 64 code units take several consecutive mask words.
+struct HyphenBreakMasks {
+    std::vector<uint64_t> bits;
+    std::vector<uint32_t> offsets; // first mask word of each word
+
+    void Clear()
+    {
+        bits.clear();
+        offsets.clear();
+    }
+    size_t Size() const
+    {
+        return offsets.size();
+    }
+    const uint64_t* Mask(size_t word) const
+    {
+        return bits.data() + offsets[word];
+    }
+    bool IsBreak(size_t word, size_t position) const
+    {
+        constexpr size_t maskBits = 64;
+        size_t end = word + 1 < offsets.size() ? offsets[word + 1] : bits.size();
+        size_t index = offsets[word] + position / maskBits;
+        return index < end && ((bits[index] >> (position % maskBits)) & 1) != 0;
+    }
+    // reduce the levels of one word (as produced by Hyphenate) to its mask
+    void Append(const std::vector<uint8_t>& levels, const HyphenBreakOptions& options);
+    void Append(const uint8_t* levels, size_t count, const HyphenBreakOptions& options);
+};
+
+// Pattern as stored in a dictionary, codes in reader form. levels[k] is the level before
+// codes[k], the levels include the padding of the rule table.
+struct HyphenStoredPattern {
+    std::vector<uint16_t> codes;
+    std::vector<uint8_t> levels;
+};
+
+struct CodeInfo;
+
+// Mapped dictionary that stays open between lookups. Lookups are quiet and
+// const, a single instance can be shared between threads.
+class HyphenDictionary {
+public:
+    ~HyphenDictionary();
+    static std::shared_ptr<HyphenDictionary> Open(const char* filePath, const HyphenOpenOptions& options = {});
+    // the dictionary keeps the image, populate does not apply
+    static std::shared_ptr<HyphenDictionary> Open(std::shared_ptr<const HpbImage> image,
+                                                  const HyphenOpenOptions& options = {});
+    static std::future<std::shared_ptr<HyphenDictionary>> OpenAsync(const std::string& filePath,
+                                                                    const HyphenOpenOptions& options = {});
+    static void OpenAsync(const std::string& filePath, const HyphenOpenOptions& options,
+                          std::function<void(std::shared_ptr<HyphenDictionary>)> callback);
+
+    // true once the startup profile has been faulted in
+    bool IsWarmedUp() const;
+    // ranges of the file currently resident in memory, to be used as a startup profile
+    std::vector<HyphenPageRange> RecordStartupProfile() const;
+    static int32_t SaveStartupProfile(const char* filePath, const std::vector<HyphenPageRange>& profile);
+    static int32_t LoadStartupProfile(const char* filePath, std::vector<HyphenPageRange>& profile);
+
+    int32_t Hyphenate(const std::vector<uint16_t>& utf16Target, std::vector<uint8_t>& result) const;
+    int32_t HyphenateBatch(const std::vector<std::vector<uint16_t>>& utf16Targets,
+                           std::vector<std::vector<uint8_t>>& results) const;
+    // odd levels reduced to break masks within the engine, see HyphenBreakMasks
+    int32_t HyphenateMasks(const std::vector<std::vector<uint16_t>>& utf16Targets, HyphenBreakMasks& masks,
+                           const HyphenBreakOptions& options = {}) const;
+    // the first count of utf16Targets only, so callers can keep reusable targets beyond that
+    int32_t HyphenateMasks(const std::vector<uint16_t>* utf16Targets, size_t count, HyphenBreakMasks& masks,
+                           const HyphenBreakOptions& options = {}) const;
+    // sorted code points the dictionary has top level entries for, in reader form
+    std::vector<uint16_t> GetCoverage() const;
+    // every pattern reachable in the dictionary, in no particular order
+    int32_t Decompile(std::vector<HyphenStoredPattern>& patterns) const;
+
+private:
+    friend class HyphenBundle;
+    HyphenDictionary();
+    int32_t Prepare(const HyphenOpenOptions& options);
+    void LockMetadata();
+    void WarmUp(std::vector<HyphenPageRange> profile);
+    void ReplicatePerNode();
+    const CodeInfo& LocalCodeInfo() const;
+
+    std::unique_ptr<CodeInfo> fCodeInfo;
+    // backs fCodeInfo when opened from memory
+    std::shared_ptr<const HpbImage> fImage;
+    // indexed by node, empty unless replicated
+    std::vector<std::unique_ptr<CodeInfo>> fReplicas;
+    std::vector<uint16_t> fCpuNodes;
+    bool fAhoCorasick{false};
+    std::thread fWarmUp;
+    std::atomic<bool> fWarmedUp{false};
+    std::atomic<bool> fStopWarmUp{false};
+    std::atomic<uint32_t> fWarmUpSum{0};
+};
+
+// All the languages of a bundle written by hpb_transform --bundle, mapped once
+class HyphenBundle : public std::enable_shared_from_this<HyphenBundle> {
+public:
+    ~HyphenBundle();
+    static std::shared_ptr<HyphenBundle> Open(const char* filePath, const HyphenOpenOptions& options = {});
+    // e.g. "hyph-en-us"
+    std::vector<std::string> GetLanguages() const;
+    // the dictionary keeps the bundle mapped, nullptr for unknown languages
+    std::shared_ptr<const HyphenDictionary> GetDictionary(const std::string& language) const;
+
+private:
+    HyphenBundle();
+
+    std::unique_ptr<CodeInfo> fCodeInfo;
+    std::map<std::string, std::unique_ptr<HyphenDictionary>> fDictionaries;
+};
 } // namespace OHOS::Hyphenate
 #endif
@@ -16,15 +16,23 @@
 #include "hyphen_pattern.h"
 
 #include <algorithm>
+#include <array>
 #include <cstddef>
 #include <climits>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <map>
+#include <queue>
+#include <set>
+#include <sstream>
+#include <unistd.h>
 #include <unicode/utf.h>
 #include <unicode/utf8.h>
+#include <zlib.h>
 
 using namespace std;
 
@@ -46,8 +54,79 @@ struct Rule {
     map<uint16_t, Leaf> uniqLeafs;
 };
 
-static map<vector<uint8_t>, Rule> g_allRules;
+// Canonical subtree identity: rule offset of the node and its (code, subtree id) children
+using SubtreeKey = pair<uint16_t, vector<pair<uint16_t, uint32_t>>>;
 
+// Subtree already written to the output, offsets are only valid within the same base
+struct WrittenSubtree {
+    uint32_t base{0};
+    uint16_t value{0};
+};
+
+// Layout of the file being written, reported with --stats
+constexpr size_t PATH_TYPE_COUNT = 4;
+struct BuildStats {
+    size_t patterns{0};
+    size_t duplicatePatterns{0};
+    size_t conflictingDuplicates{0}; // redefined with other levels, the last definition wins
+    array<size_t, PATH_TYPE_COUNT> nodeTypes{};
+    map<size_t, size_t> fanOut;       // children of the written nodes
+    map<size_t, size_t> linearChains; // codes in the linear nodes
+    map<size_t, size_t> radixEdges;   // codes in the linear nodes continuing into a branching node
+    uint32_t maxRulePos{0};
+    uint32_t maxNodeOffset{0}; // relative to the base, in 16 bits
+};
+
+// Everything one build keeps track of. Every build has its own, reached through g_build
+// on the thread running it (see BuildScope), so builds can run one after another and
+// side by side in the same process.
+struct BuildState {
+    map<vector<uint8_t>, Rule> allRules;
+    map<SubtreeKey, uint32_t> subtreeIds;
+    map<uint32_t, WrittenSubtree> writtenSubtrees;
+    BuildStats stats;
+    size_t pathCount{0};
+    size_t leafCount{0};
+    size_t sharedSubtreeCount{0};
+    size_t droppedCount{0};
+    size_t droppedPatterns{0}; // patterns only reachable through dropped nodes
+    bool frequencyOrder{false};
+    bool radixEdges{false};
+    uint16_t minimumCP{MAXIMUM_DIRECT_CODE_POINT};
+    uint16_t maximumCP{'_'};
+    bool verbose{true};
+    bool failed{false}; // the binary cannot be written, see the error output
+};
+
+static thread_local BuildState* g_build{nullptr};
+
+// Makes state the build state of the calling thread until the end of the scope
+class BuildScope {
+public:
+    explicit BuildScope(BuildState& state) : fPrevious(g_build)
+    {
+        g_build = &state;
+    }
+    ~BuildScope()
+    {
+        g_build = fPrevious;
+    }
+    BuildScope(const BuildScope&) = delete;
+    BuildScope& operator=(const BuildScope&) = delete;
+
+private:
+    BuildState* fPrevious;
+};
+
+// Progress output of the build, dropped for quiet builds
+static ostream& Log()
+{
+    static thread_local ostream quiet(nullptr);
+    return g_build == nullptr || g_build->verbose ? cout : quiet;
+}
+
+#ifndef HPB_BUILDER_LIBRARY
+// the library links with the reader, which has the same conversion
 vector<uint16_t> ConvertToUtf16(const string& utf8Str)
 {
     int32_t i = 0;
@@ -65,6 +144,7 @@ vector<uint16_t> ConvertToUtf16(const string& utf8Str)
     }
     return target;
 }
+#endif
 
 // Recursive path implementation.
 // Collects static information and the leafs that provide access to patterns
@@ -72,14 +152,14 @@ vector<uint16_t> ConvertToUtf16(const string& utf8Str)
 struct Path {
     explicit Path(const vector<uint16_t>& path, const vector<uint8_t>* pat)
     {
-        count++;
+        g_build->pathCount++;
         size_t targetIndex = path.size();
         if (targetIndex > 0) {
             code = path[--targetIndex];
         }
         if ((code <= MAXIMUM_DIRECT_CODE_POINT)) {
-            maximumCP = max(maximumCP, code);
-            minimumCP = min(minimumCP, code);
+            g_build->maximumCP = max(g_build->maximumCP, code);
+            g_build->minimumCP = min(g_build->minimumCP, code);
         }
 
         // Process children recursively
@@ -88,7 +168,7 @@ struct Path {
         } else {
             // store pattern to leafs
             pattern = pat;
-            leafCount++;
+            g_build->leafCount++;
         }
     }
 
@@ -123,14 +203,43 @@ struct Path {
             for (auto& path : paths) {
                 path.second.FindSharedLeaves();
             }
-        } else if (g_allRules.count(*pattern) != 0) {
-            auto ite = g_allRules[*pattern].uniqLeafs.find(code);
-            if (ite != g_allRules[*pattern].uniqLeafs.cend()) {
+        } else if (g_build->allRules.count(*pattern) != 0) {
+            auto ite = g_build->allRules[*pattern].uniqLeafs.find(code);
+            if (ite != g_build->allRules[*pattern].uniqLeafs.cend()) {
                 ite->second.usecount += 1;
             }
         }
     }
 
+    // Hash-cons the subtree bottom up, identical structures with identical
+    // rules get the same id and can be written only once
+    void AssignSubtreeIds()
+    {
+        SubtreeKey key;
+        if (HasPattern()) {
+            key.first = g_build->allRules[*pattern].offset;
+        }
+        for (auto& path : paths) {
+            path.second.AssignSubtreeIds();
+            key.second.emplace_back(path.first, path.second.subtreeId);
+        }
+        auto ite = g_build->subtreeIds.find(key);
+        if (ite == g_build->subtreeIds.end()) {
+            ite = g_build->subtreeIds.emplace(key, static_cast<uint32_t>(g_build->subtreeIds.size() + 1)).first;
+        }
+        subtreeId = ite->second;
+    }
+
+    // patterns ending in this subtree, including the one of this node
+    size_t PatternCount() const
+    {
+        size_t count = HasPattern() ? 1 : 0;
+        for (const auto& path : paths) {
+            count += path.second.PatternCount();
+        }
+        return count;
+    }
+
     // Once this node is reached, we can access pattern
     // however traversing further may be needed
     bool HasPattern() const { return pattern != nullptr; }
@@ -154,29 +263,29 @@ struct Path {
 #ifdef VERBOSE_PATTERNS
         indent += HYPHEN_INDENT_INCREMENT;
         for (size_t i = 0; i < indent; i++) {
-            cout << " ";
+            Log() << " ";
         }
         if (indent == ROOT_INDENT) {
-            cout << char(code) << "rootsize***: " << paths.size();
+            Log() << char(code) << "rootsize***: " << paths.size();
         } else {
-            cout << char(code) << "***: " << paths.size();
+            Log() << char(code) << "***: " << paths.size();
         }
         if (paths.size() >= LARGE_PATH_SIZE)
-            cout << " LARGE";
+            Log() << " LARGE";
         else if (IsLinear()) {
-            cout << " LINEAR";
+            Log() << " LINEAR";
         } else {
-            cout << " @@@";
+            Log() << " @@@";
         }
 
-        cout << endl;
+        Log() << endl;
         if (paths.size() == 0) {
             return;
         }
         for (auto path : paths) {
             path.second.Print(indent);
         }
-        cout << endl;
+        Log() << endl;
 #endif
     }
 
@@ -214,6 +323,27 @@ struct Path {
         return size;
     }
 
+    // two levels per byte, low nibble first, returns the amount of levels written
+    static uint16_t WritePackedNibbles(const vector<uint8_t>& data, ostream& out)
+    {
+        uint16_t size = data.size();
+        if ((data.size() % NIBBLE_PADDING_SIZE) != 0) {
+            cerr << "### nibble packed vectors should be aligned in 8 levels !!!" << endl;
+            size = size - (size % NIBBLE_PADDING_SIZE);
+        }
+
+        constexpr uint8_t NIBBLE_MASK = 0x0f;
+        constexpr size_t NIBBLE_BITS = 4;
+        for (size_t i = 0; i < size; i += HYPHEN_BASE_CODE_SHIFT) {
+            if (data[i] > NIBBLE_MASK || data[i + 1] > NIBBLE_MASK) {
+                cerr << "### level does not fit into nibble !!!" << endl;
+            }
+            uint8_t byte = (data[i] & NIBBLE_MASK) | ((data[i + 1] & NIBBLE_MASK) << NIBBLE_BITS);
+            out.write(reinterpret_cast<const char*>(&byte), sizeof(byte));
+        }
+        return size;
+    }
+
     // no need to twiddle the bytes or words currently
     static void WritePacked(uint32_t word, ostream& out)
     {
@@ -242,6 +372,7 @@ struct Path {
         const auto* path = &(ite->second);
         auto localPattern = path->pattern;
         output.push_back(path->code);
+        size_t chain = 1;
 
         while (path) {
             if (localPattern) {
@@ -260,6 +391,7 @@ struct Path {
                     path = &(itr->second);
                     localPattern = path->pattern;
                     output.push_back(path->code);
+                    chain++;
                 } else {
                     break;
                 }
@@ -272,6 +404,7 @@ struct Path {
             // mark array end so that reader knows when to stop recursing
             uint16_t size = 0;
             out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+            g_build->stats.linearChains[chain]++;
         }
     }
 
@@ -279,44 +412,113 @@ struct Path {
     {
         uint16_t size = 0;
         if (HasPattern()) {
-            auto ite = g_allRules.find(*pattern);
+            auto ite = g_build->allRules.find(*pattern);
             size = ite->second.offset;
         }
 
         out.write(reinterpret_cast<const char*>(&size), sizeof(size));
     }
 
+    // Children in the order their subtrees are written. Nodes follow their children, so with
+    // a corpus the most visited child is written last, right before this node.
+    vector<const pair<const uint16_t, Path>*> WriteOrder() const
+    {
+        vector<const pair<const uint16_t, Path>*> order;
+        for (const auto& path : paths) {
+            order.push_back(&path);
+        }
+        if (g_build->frequencyOrder) {
+            stable_sort(order.begin(), order.end(),
+                        [](const auto* a, const auto* b) { return a->second.visits < b->second.visits; });
+        }
+        return order;
+    }
+
+    void WritePairs(ostream& out, uint32_t offset, uint32_t& pos) const
+    {
+        map<uint16_t, uint16_t> values;
+        for (const auto* path : WriteOrder()) {
+            values[path->first] = path->second.Write(out, offset);
+        }
+        pos = static_cast<uint32_t>(out.tellp()); // our header is after children data
+        WritePatternOrNull(out);
+        // sorted by code so that lookups can stop early, or by visits for a linear scan
+        vector<const pair<const uint16_t, Path>*> order;
+        for (const auto& path : paths) {
+            order.push_back(&path);
+        }
+        if (g_build->frequencyOrder) {
+            stable_sort(order.begin(), order.end(),
+                        [](const auto* a, const auto* b) { return a->second.visits > b->second.visits; });
+        }
+        vector<uint16_t> output;
+        bool sorted = true;
+        for (size_t i = 0; i < order.size(); i++) {
+            output.push_back(order[i]->first);
+            output.push_back(values[order[i]->first]);
+            sorted = sorted && (i == 0 || order[i - 1]->first < order[i]->first);
+        }
+        uint16_t count = static_cast<uint16_t>(output.size()) | (sorted ? 0 : PAIRS_FREQUENCY_ORDER);
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        WritePacked(output, out, false);
+    }
+
+    // A run of single child nodes inside a branching subtree. Written as a linear chain like
+    // WritePackedLine does, the last segment ends with the code of the branching node and is
+    // followed by its value, so the lookup continues there after comparing the whole run.
+    void WriteRadixEdge(ostream& out, uint32_t offset, uint32_t& pos, PathType& type) const
+    {
+        vector<const Path*> run{&paths.cbegin()->second};
+        while (run.back()->paths.size() == 1) {
+            run.push_back(&run.back()->paths.cbegin()->second);
+        }
+        uint16_t value = run.back()->Write(out, offset);
+        pos = static_cast<uint32_t>(out.tellp()); // children first
+        WritePatternOrNull(out);
+        vector<uint16_t> output;
+        for (const Path* path : run) {
+            output.push_back(path->code);
+            if (path != run.back() && path->HasPattern()) {
+                WritePacked(output, out);
+                path->WritePatternOrNull(out);
+                output.clear();
+            }
+        }
+        uint16_t count = static_cast<uint16_t>(output.size()) | LINEAR_CONTINUATION;
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        WritePacked(output, out, false);
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        type = PathType::LINEAR;
+        g_build->stats.radixEdges[run.size()]++;
+    }
+
     void WriteTypedNode(ostream& out, uint32_t offset, uint32_t& pos, PathType& type) const
     {
         // check if we are linear or should write a table
         if (IsLinear()) {
             WritePatternOrNull(out);
             WritePackedLine(*this, out, type);
-        } else if ((paths.size() < static_cast<size_t>(maximumCP - minimumCP) / HYPHEN_BASE_CODE_SHIFT)
-                   || haveNoncontiguousChildren) {
+        } else if (paths.size() == 1 && g_build->radixEdges) {
+            WriteRadixEdge(out, offset, pos, type);
+        } else if ((paths.size() <
+                    static_cast<size_t>(g_build->maximumCP - g_build->minimumCP) / HYPHEN_BASE_CODE_SHIFT) ||
+                   haveNoncontiguousChildren) {
             // Using dense table, i.e. value pairs
-            vector<uint16_t> output;
-            for (const auto& path : paths) {
-                output.push_back(path.first);
-                output.push_back(path.second.Write(out, offset));
-            }
-            pos = static_cast<uint32_t>(out.tellp()); // our header is after children data
+            WritePairs(out, offset, pos);
             type = PathType::PAIRS;
-            WritePatternOrNull(out);
-            WritePacked(output, out);
         } else {
             // Direct pointing, initialize full mapping table
             vector<uint16_t> output;
-            output.resize(maximumCP - minimumCP + 1, 0);
+            output.resize(g_build->maximumCP - g_build->minimumCP + 1, 0);
             if ((output.size() & 0x1) != 0) {
                 output.push_back(0); // pad
             }
-            for (const auto& path : paths) {
+            for (const auto* path : WriteOrder()) {
                 // traverse children recursively (dfs)
-                if (path.first >= minimumCP && path.first <= maximumCP) {
-                    output[path.first - minimumCP] = path.second.Write(out, offset);
+                if (path->first >= g_build->minimumCP && path->first <= g_build->maximumCP) {
+                    output[path->first - g_build->minimumCP] = path->second.Write(out, offset);
                 } else {
-                    cerr << " ### Encountered distinct code point 0x'" << hex << static_cast<int>(path.first) <<
+                    cerr << " ### Encountered distinct code point 0x'" << hex << static_cast<int>(path->first) <<
                         " when writing direct array" << endl;
                 }
             }
@@ -328,63 +530,117 @@ struct Path {
 
     uint16_t Write(ostream& out, uint32_t offset = 0, uint32_t* endPos = nullptr) const
     {
-        if (HasPattern() && paths.size() == 0) { // currently only leafs are shared
+        if (HasPattern() && paths.size() == 0) { // leafs are shared accross the whole file
             // if we have a shared leaf for shared pattern, use it
-            if (auto ite = g_allRules[*pattern].uniqLeafs.find(code); ite != g_allRules[*pattern].uniqLeafs.cend()) {
+            auto& uniqLeafs = g_build->allRules[*pattern].uniqLeafs;
+            if (auto ite = uniqLeafs.find(code); ite != uniqLeafs.cend()) {
                 if (ite->second.offset != 0) {
+                    // nothing written, but the next top level entry starts from here
+                    if (endPos) {
+                        *endPos = static_cast<uint32_t>(out.tellp()) >> 1;
+                    }
                     return ite->second.offset;
                 }
             }
         }
+        // other subtrees can be shared only with the nodes using the same base offset,
+        // i.e. within the same top level code point
+        auto& written = g_build->writtenSubtrees;
+        if (auto ite = written.find(subtreeId); subtreeId != 0 && ite != written.cend() && ite->second.base == offset) {
+            g_build->sharedSubtreeCount++;
+            if (endPos) {
+                *endPos = static_cast<uint32_t>(out.tellp()) >> 1;
+            }
+            return ite->second.value;
+        }
 
         PathType type = PathType::DIRECT;
         uint32_t pos = static_cast<uint32_t>(out.tellp());
         uint32_t oPos = pos;
+        size_t droppedPatterns = g_build->droppedPatterns;
 
         WriteTypedNode(out, offset, pos, type);
 
         // return overall offset in 16bit
-        CheckThatDataFits(pos, offset, out, type, oPos);
+        if (!CheckThatDataFits(pos, offset, out, oPos)) {
+            if (endPos) {
+                *endPos = static_cast<uint32_t>(out.tellp()) >> 1;
+            }
+            uint16_t value = DroppedValue();
+            // the whole subtree is gone, including what its children had dropped already
+            g_build->droppedPatterns = droppedPatterns + PatternCount() - (value != 0 ? 1 : 0);
+            return value;
+        }
+        g_build->stats.nodeTypes[static_cast<size_t>(type)]++;
+        g_build->stats.fanOut[paths.size()]++;
+        if ((pos >> 1) > offset) {
+            g_build->stats.maxNodeOffset = max(g_build->stats.maxNodeOffset, (pos >> 1) - offset);
+        }
         if (endPos) {
             *endPos = static_cast<uint32_t>(out.tellp()) >> 1;
         }
-        return (((pos >> 1) - offset) | (static_cast<uint32_t>(type) << SHIFT_BITS_14));
+        uint16_t value = (((pos >> 1) - offset) | (static_cast<uint32_t>(type) << SHIFT_BITS_14));
+        if (subtreeId != 0) {
+            g_build->writtenSubtrees[subtreeId] = {offset, value};
+        }
+        return value;
     }
 
-    void CheckThatDataFits(uint32_t& pos, uint32_t offset, ostream& out, PathType& type, uint32_t oPos) const
+    static void RollBack(ostream& out, uint32_t oPos, uint32_t offset)
+    {
+        out.seekp(oPos, ios_base::beg); // roll back to the beginning of this entry
+        if (!out.good()) {
+            // failing to roll back, the build is lost
+            cerr << "Could not roll back outfile, terminating" << endl;
+            g_build->failed = true;
+            return;
+        }
+        // children written past the roll back point are gone, they cannot be shared anymore
+        for (auto ite = g_build->writtenSubtrees.begin(); ite != g_build->writtenSubtrees.end();) {
+            uint32_t written = ite->second.base + (ite->second.value & 0x3fff);
+            if (ite->second.base == offset && written >= (oPos >> 1)) {
+                ite = g_build->writtenSubtrees.erase(ite);
+            } else {
+                ++ite;
+            }
+        }
+    }
+
+    // false when the node is past the offset range of its base, it is rolled back then
+    bool CheckThatDataFits(uint32_t pos, uint32_t offset, ostream& out, uint32_t oPos) const
     {
-        // return overall offset in 16bit
         if (((pos >> 1) > offset) && ((pos >> 1) - offset) > 0x3fff) {
             cerr << " ### Cannot fit offset " << hex << pos << " : " << offset
                  << " into 14 bits, dropping node" << endl;
-            out.seekp(oPos, ios_base::beg); // roll back to the beginning of this entry
-            if (!out.good()) {
-                // failing to roll back, terminate
-                cerr << "Could not roll back outfile, terminating" << endl;
-                exit(-1);
-            }
-            WritePatternOrNull(out);
-            type = PathType::PATTERN;
-            pos = static_cast<uint32_t>(out.tellp());
+            g_build->droppedCount++;
+            RollBack(out, oPos, offset);
+            return false;
         }
+        return true;
     }
 
-    static size_t count;
-    static size_t leafCount;
-    static uint16_t minimumCP;
-    static uint16_t maximumCP;
+    // Stands in for a dropped node. Pattern nodes are relative to the common node base, so the
+    // node keeps its own pattern only through a shared leaf of the same rule, else it has none.
+    uint16_t DroppedValue() const
+    {
+        if (HasPattern()) {
+            for (const auto& leaf : g_build->allRules[*pattern].uniqLeafs) {
+                if (leaf.second.offset != 0) {
+                    return leaf.second.offset;
+                }
+            }
+        }
+        return static_cast<uint16_t>(PathType::PATTERN) << SHIFT_BITS_14; // zero word at the common base
+    }
 
     uint16_t code{0};
     map<uint16_t, Path> paths;
     const vector<uint8_t>* pattern{nullptr};
     bool haveNoncontiguousChildren{false};
+    uint32_t subtreeId{0};
+    uint64_t visits{0}; // lookups reaching this node in the corpus
 };
 
-size_t Path::count{0};
-size_t Path::leafCount{0};
-uint16_t Path::minimumCP = 0x7a;
-uint16_t Path::maximumCP = 0x5f;
-
 // Struct to hold all the patterns that end with the code.
 struct PatternHolder {
     uint16_t code{0};
@@ -422,7 +678,7 @@ void processSection(const string& line, map<string, vector<string>>& sections, v
     for (size_t i = 1; i < line.size() && !iswspace(line[i]) && line[i] != '{'; i++) {
         pat += line[i];
     }
-    cout << "resolved section: " << pat << endl;
+    Log() << "resolved section: " << pat << endl;
     if (!pat.empty()) {
         sections[pat] = vector<string>();
         current = &sections[pat];
@@ -443,7 +699,7 @@ static void ProcessContent(const string& line, vector<string>* current)
         if (code == '%') {
             break;
         }
-        // cout << code;
+        // Log() << code;
         pat += code;
     }
     if (!pat.empty()) {
@@ -470,11 +726,11 @@ static int32_t ResolveSectionsFromFile(const std::string& fileName, map<string,
 {
     char resolvedPath[PATH_MAX] = {0};
     if (fileName.size() > PATH_MAX) {
-        cout << "The file name is too long" << endl;
+        Log() << "The file name is too long" << endl;
         return FAILED;
     }
     if (realpath(fileName.c_str(), resolvedPath) == nullptr) {
-        cout << "file name exception" << endl;
+        Log() << "file name exception" << endl;
         return FAILED;
     }
 
@@ -491,10 +747,10 @@ static int32_t ResolveSectionsFromFile(const std::string& fileName, map<string,
         ProcessLine(line, current, uncategorized, sections);
     }
 
-    cout << "Uncategorized data size: " << uncategorized.size() << endl;
-    cout << "Amount of sections: " << sections.size() << endl;
+    Log() << "Uncategorized data size: " << uncategorized.size() << endl;
+    Log() << "Amount of sections: " << sections.size() << endl;
     for (const auto& section : sections) {
-        cout << "  '" << section.first << "' size: " << section.second.size() << endl;
+        Log() << "  '" << section.first << "' size: " << section.second.size() << endl;
     }
     return SUCCEED;
 }
@@ -519,20 +775,26 @@ static vector<uint16_t> ProcessWord(const string& wordString)
     // match exceptions in full words only
     result.insert(result.cbegin(), '.');
     result.push_back('.');
-    cout << "Adding exception: " << wordString << endl;
+    Log() << "Adding exception: " << wordString << endl;
     return result;
 }
 
-static void ResolvePatternsFromSections(map<string, vector<string>>& sections, vector<vector<uint16_t>>& utf16Patterns)
+static void ResolvePatterns(const vector<string>& patterns, const vector<string>& exceptions,
+                            vector<vector<uint16_t>>& utf16Patterns)
 {
-    for (const auto& pattern : sections["patterns"]) {
+    for (const auto& pattern : patterns) {
         utf16Patterns.push_back(ConvertToUtf16(pattern));
     }
-    for (const auto& word : sections["hyphenation"]) {
+    for (const auto& word : exceptions) {
         utf16Patterns.push_back(ProcessWord(word));
     }
 }
 
+static void ResolvePatternsFromSections(map<string, vector<string>>& sections, vector<vector<uint16_t>>& utf16Patterns)
+{
+    ResolvePatterns(sections["patterns"], sections["hyphenation"], utf16Patterns);
+}
+
 static void CollectLeaves(const vector<uint16_t>& pattern, uint16_t& ix)
 {
     for (size_t i = pattern.size(); i > 0;) {
@@ -573,22 +835,24 @@ static void ProcessPattern(const vector<uint16_t>& pattern, vector<uint16_t>& co
     }
 }
 
-static void PadRules(vector<uint8_t>& rules)
+static void PadRules(vector<uint8_t>& rules, size_t padding)
 {
-    while ((rules.size() % PADDING_SIZE) != 0) {
+    while ((rules.size() % padding) != 0) {
         if (rules.back() == 0) {
             rules.pop_back();
         } else {
             break;
         }
     }
-    while ((rules.size() % PADDING_SIZE) != 0) {
+    while ((rules.size() % padding) != 0) {
         rules.push_back(0);
     }
 }
 
-void ResolveLeavesFromPatterns(const vector<vector<uint16_t>>& utf16Patterns, map<uint16_t, PatternHolder>& leaves)
+void ResolveLeavesFromPatterns(const vector<vector<uint16_t>>& utf16Patterns, map<uint16_t, PatternHolder>& leaves,
+                               const HyphenBuildOptions& options)
 {
+    const size_t padding = options.nibbleRules ? NIBBLE_PADDING_SIZE : PADDING_SIZE;
     for (const auto& pattern : utf16Patterns) {
         uint16_t ix{0};
         CollectLeaves(pattern, ix);
@@ -605,7 +869,9 @@ void ResolveLeavesFromPatterns(const vector<vector<uint16_t>>& utf16Patterns, ma
         ProcessPattern(pattern, codepoints, rules);
 
         leaves[ix].code = ix;
-        if (leaves[ix].patterns.find(codepoints) != leaves[ix].patterns.cend()) {
+        g_build->stats.patterns++;
+        auto duplicate = leaves[ix].patterns.find(codepoints);
+        if (duplicate != leaves[ix].patterns.cend()) {
             cerr << "### Multiple definitions for pattern with size: " << codepoints.size() << endl;
             cerr << "###";
             for (auto codepoint : codepoints) {
@@ -614,19 +880,23 @@ void ResolveLeavesFromPatterns(const vector<vector<uint16_t>>& utf16Patterns, ma
             cerr << endl;
         }
 
-        PadRules(rules);
+        PadRules(rules, padding);
+        if (duplicate != leaves[ix].patterns.cend()) {
+            g_build->stats.duplicatePatterns++;
+            g_build->stats.conflictingDuplicates += duplicate->second != rules ? 1 : 0;
+        }
         leaves[ix].patterns[codepoints] = rules;
         // collect a list of unique rules
-        if (auto it = OHOS::Hyphenate::g_allRules.find(rules); it != OHOS::Hyphenate::g_allRules.end()) {
+        if (auto it = g_build->allRules.find(rules); it != g_build->allRules.end()) {
             it->second.patterns[ix].push_back(codepoints);
         } else {
-            OHOS::Hyphenate::g_allRules[rules] = Rule();
-            Hyphenate::g_allRules[rules].patterns[ix].push_back(codepoints);
+            g_build->allRules[rules] = Rule();
+            g_build->allRules[rules].patterns[ix].push_back(codepoints);
         }
     }
 
-    cout << "leaves: " << leaves.size() << endl;
-    cout << "unique rules: " << OHOS::Hyphenate::g_allRules.size() << endl;
+    Log() << "leaves: " << leaves.size() << endl;
+    Log() << "unique rules: " << g_build->allRules.size() << endl;
 }
 
 static void BreakLeavesIntoPaths(map<uint16_t, PatternHolder>& leaves, CpRange& range, int& countPat)
@@ -634,7 +904,7 @@ static void BreakLeavesIntoPaths(map<uint16_t, PatternHolder>& leaves, CpRange&
     bool printCounts = true;
     // break leave information to Path instances
     for (auto& leave : leaves) {
-        cout << "  '" << char(leave.first) << "' rootsize: " << leave.second.patterns.size() << endl;
+        Log() << "  '" << char(leave.first) << "' rootsize: " << leave.second.patterns.size() << endl;
         for (const auto& pat : leave.second.patterns) {
             if (auto ite = leave.second.paths.find(pat.first[pat.first.size() - 1]); ite != leave.second.paths.end()) {
                 ite->second.Process(pat.first, pat.first.size() - 1, &pat.second);
@@ -642,20 +912,20 @@ static void BreakLeavesIntoPaths(map<uint16_t, PatternHolder>& leaves, CpRange&
                 leave.second.paths.emplace(pat.first[pat.first.size() - 1], Path(pat.first, &pat.second));
             }
 #ifdef VERBOSE_PATTERNS
-            cout << "    '";
+            Log() << "    '";
             for (const auto& digit : pat.first) {
-                cout << "'0x" << hex << static_cast<int>(digit) << "' ";
+                Log() << "'0x" << hex << static_cast<int>(digit) << "' ";
             }
-            cout << "' size: " << pat.second.size() << endl;
-            cout << "       ";
+            Log() << "' size: " << pat.second.size() << endl;
+            Log() << "       ";
 #endif
             for (const auto& digit : pat.second) {
                 (void)digit;
                 countPat++;
 #ifdef VERBOSE_PATTERNS
-                cout << "'" << to_string(digit) << "' ";
+                Log() << "'" << to_string(digit) << "' ";
             }
-            cout << endl;
+            Log() << endl;
 #else
             }
 #endif
@@ -664,10 +934,10 @@ static void BreakLeavesIntoPaths(map<uint16_t, PatternHolder>& leaves, CpRange&
         // collect some stats
         for (auto path : leave.second.paths) {
             if (printCounts) {
-                cout << "leafs-nodes: " << path.second.leafCount << " / " << path.second.count << endl;
-                cout << "min-max: " << path.second.minimumCP << " / " << path.second.maximumCP << endl;
-                range.minimumCp = path.second.minimumCP;
-                range.maximumCp = path.second.maximumCP;
+                Log() << "leafs-nodes: " << g_build->leafCount << " / " << g_build->pathCount << endl;
+                Log() << "min-max: " << g_build->minimumCP << " / " << g_build->maximumCP << endl;
+                range.minimumCp = g_build->minimumCP;
+                range.maximumCp = g_build->maximumCP;
                 break;
             }
             path.second.Print(HYPHEN_DEFAULT_INDENT);
@@ -675,9 +945,72 @@ static void BreakLeavesIntoPaths(map<uint16_t, PatternHolder>& leaves, CpRange&
     }
 }
 
+// Corpus words are mapped the same way as the reader maps its input
+static uint16_t MapCorpusCode(uint16_t code)
+{
+    if (code == '.') {
+        return '`';
+    } else if (code == '-') {
+        return '_';
+    } else if (code == '\'') {
+        return '^';
+    }
+    return code < 0x80 ? static_cast<uint16_t>(tolower(code)) : code;
+}
+
+// Count how often every node is reached when the corpus words are looked up
+static int32_t CountCorpusVisits(const string& corpusPath, map<uint16_t, PatternHolder>& leaves)
+{
+    ifstream input(corpusPath);
+    if (!input.good()) {
+        cerr << "could not open corpus '" << corpusPath << "'" << endl;
+        return FAILED;
+    }
+    size_t words = 0;
+    for (string line; getline(input, line);) {
+        istringstream fields(line);
+        string word;
+        uint64_t frequency = 1;
+        if (!(fields >> word)) {
+            continue;
+        }
+        if (uint64_t count = 0; fields >> count) {
+            frequency = count;
+        }
+        vector<uint16_t> target{MapCorpusCode('.')};
+        for (auto code : ConvertToUtf16(word)) {
+            target.push_back(MapCorpusCode(code));
+        }
+        target.push_back(MapCorpusCode('.'));
+        words++;
+        for (size_t end = target.size() - 1; end > 0; end--) {
+            auto leave = leaves.find(target[end]);
+            if (leave == leaves.end()) {
+                continue;
+            }
+            auto root = leave->second.paths.find(target[end]);
+            if (root == leave->second.paths.end()) {
+                continue;
+            }
+            Path* node = &root->second;
+            node->visits += frequency;
+            for (size_t i = end; i > 0;) {
+                auto child = node->paths.find(target[--i]);
+                if (child == node->paths.end()) {
+                    break;
+                }
+                node = &child->second;
+                node->visits += frequency;
+            }
+        }
+    }
+    Log() << "corpus words: " << words << endl;
+    return SUCCEED;
+}
+
 const size_t FULL_TALBLE = 4;
 
-static uint32_t InitOutFileHead(ofstream& out)
+static uint32_t InitOutFileHead(ostream& out)
 {
     // reserve space for:
     // - header
@@ -691,7 +1024,8 @@ static uint32_t InitOutFileHead(ofstream& out)
     return FULL_TALBLE * 2; // return 2 multiple talble size, check this number
 }
 
-static int32_t FormatOutFileHead(ofstream& out, const WriteOffestsParams& params, const uint32_t toc)
+static int32_t FormatOutFileHead(ostream& out, const WriteOffestsParams& params, const uint32_t toc,
+                                 const HyphenBuildOptions& options, bool codeFilter)
 {
     out.seekp(ios::beg); // roll back to the beginning
     if (!out.good()) {
@@ -708,10 +1042,15 @@ static int32_t FormatOutFileHead(ofstream& out, const WriteOffestsParams& params
     out.write(reinterpret_cast<const char*>(&toc), sizeof(toc));
     // write mappings
     out.write(reinterpret_cast<const char*>(&params.fMappingsPos), sizeof(params.fMappingsPos));
-    // write binary version 8 top bits, using the lower 24 bits for common node offset without
+    // write binary version 8 top bits, using the lower 16 bits for common node offset without
     // needing to increase header size overall offset on the binary file
-    // we may want to change this at some point
-    const uint32_t version = (0x2 << 0x18) | params.fCommonNodeOffset;
+    // bits 16..23 hold the feature flags, files using any of them are marked as version 3
+    uint32_t flags = options.nibbleRules ? HYPHEN_FLAG_NIBBLE_RULES : 0;
+    flags |= options.corpus.empty() ? 0 : HYPHEN_FLAG_FREQUENCY_PAIRS;
+    flags |= codeFilter ? HYPHEN_FLAG_CODE_FILTER : 0;
+    flags |= options.radixEdges ? HYPHEN_FLAG_RADIX_EDGES : 0;
+    const uint32_t version = ((flags != 0 ? BINARY_VERSION_FLAGS : BINARY_VERSION) << 0x18) |
+        (flags << SHIFT_BITS_FLAGS) | params.fCommonNodeOffset;
     out.write(reinterpret_cast<const char*>(&version), sizeof(version));
 
     return SUCCEED;
@@ -728,62 +1067,101 @@ void ProcessUniqueRule(std::pair<const vector<uint8_t>, Rule>& uniqueRule)
     }
 }
 
-void WriteUniqueRules(ofstream& out)
+void WriteUniqueRules(ostream& out, const HyphenBuildOptions& options)
 {
-    for (auto& uniqueRule : OHOS::Hyphenate::g_allRules) {
+    for (auto& uniqueRule : g_build->allRules) {
         uint32_t pos = static_cast<uint32_t>(out.tellp());
-        uint16_t size = Path::WritePacked(uniqueRule.first, out, false) / 0x4; // save bits by padding size
+        // save bits by padding size, the count is stored in 32 bit words
+        uint16_t size = options.nibbleRules ? Path::WritePackedNibbles(uniqueRule.first, out) / NIBBLE_PADDING_SIZE
+                                            : Path::WritePacked(uniqueRule.first, out, false) / PADDING_SIZE;
         uniqueRule.second.offset = (size << 0xc) | pos;
+        g_build->stats.maxRulePos = max(g_build->stats.maxRulePos, pos);
         ProcessUniqueRule(uniqueRule);
         if ((pos >> 0xc) != 0) {
             cerr << "PATTERNS: RUNNING OUT OF ADDRESS SPACE, file a bug" << endl;
-            exit(-1);
+            g_build->failed = true;
+            return;
         }
     }
 }
 
-void WriteSharedLeafs(ofstream& out, uint16_t& pos, uint32_t& end)
+void WriteSharedLeafs(ostream& out, uint16_t& pos, uint32_t& end)
 {
-    for (auto& uniqueRule : OHOS::Hyphenate::g_allRules) {
-        cout << "###### UniqueRule with " << uniqueRule.second.patterns.size() << " leaves" << endl;
+    for (auto& uniqueRule : g_build->allRules) {
+        Log() << "###### UniqueRule with " << uniqueRule.second.patterns.size() << " leaves" << endl;
         for (auto& sharedLeaf : uniqueRule.second.uniqLeafs) {
             if (sharedLeaf.second.usecount > 0) {
                 Path path({sharedLeaf.first}, &uniqueRule.first);
+                path.AssignSubtreeIds();
                 sharedLeaf.second.offset = path.Write(out, pos, &end);
-                cout << "found unique " << hex << static_cast<int>(sharedLeaf.first) <<
+                Log() << "found unique " << hex << static_cast<int>(sharedLeaf.first) <<
                     " wrote: '" << sharedLeaf.second.offset << "' " << endl;
             }
         }
     }
 }
 
-uint16_t CheckSharedLeaves(ofstream& out, map<uint16_t, PatternHolder>& leaves)
+uint16_t CheckSharedLeaves(ostream& out, map<uint16_t, PatternHolder>& leaves)
 {
     // check how many of the unique rules remain valid once all the rules are combined
     for (auto& leave : leaves) {
         for (auto& path : leave.second.paths) {
             path.second.FindSharedLeaves();
+            path.second.AssignSubtreeIds();
         }
     }
+    Log() << "unique subtrees: " << g_build->subtreeIds.size() << " / " << g_build->pathCount << endl;
     uint32_t end{0};
     if ((out.tellp() % 1) != 0) {
         out.write(reinterpret_cast<const char*>(&end), 1);
     }
     uint16_t pos = static_cast<uint16_t>(out.tellp()) >> 1;
-    cout << "NOW THIS IS PURE MAGIC NUMBER FOR NOW: " << hex << pos << endl;
+    Log() << "NOW THIS IS PURE MAGIC NUMBER FOR NOW: " << hex << pos << endl;
     // pad first offset with 16bit zero to make empty patterns ignore the zero offset
     out.write(reinterpret_cast<const char*>(&end), 2);
     WriteSharedLeafs(out, pos, end);
     return pos;
 }
 
-static bool WriteLeavePathsToOutFile(map<uint16_t, PatternHolder>& leaves, const CpRange& range, ofstream& out,
-                                     uint32_t& tableOffset, vector<PathOffset>& offsets)
+// Writes the subtree of a top level entry. The frequency order moves nodes away from where the
+// code order has them, so entries it would drop nodes of are written in code order instead and
+// a corpus never loses more patterns than the default layout.
+static uint16_t WriteTopLevelPath(const Path& path, ostream& out, uint32_t tableOffset, uint32_t& end)
+{
+    if (!g_build->frequencyOrder) {
+        return path.Write(out, tableOffset, &end);
+    }
+    uint32_t start = static_cast<uint32_t>(out.tellp());
+    BuildStats stats = g_build->stats;
+    size_t shared = g_build->sharedSubtreeCount;
+    size_t dropped = g_build->droppedCount;
+    size_t droppedPatterns = g_build->droppedPatterns;
+    uint16_t value = path.Write(out, tableOffset, &end);
+    if (g_build->droppedCount == dropped) {
+        return value;
+    }
+    Log() << "frequency order drops nodes of 0x" << hex << static_cast<int>(path.code) << ", writing it in code order"
+          << dec << endl;
+    g_build->stats = stats;
+    g_build->sharedSubtreeCount = shared;
+    g_build->droppedCount = dropped;
+    g_build->droppedPatterns = droppedPatterns;
+    Path::RollBack(out, start, tableOffset);
+    g_build->frequencyOrder = false;
+    value = path.Write(out, tableOffset, &end);
+    g_build->frequencyOrder = true;
+    return value;
+}
+
+static bool WriteLeavePathsToOutFile(map<uint16_t, PatternHolder>& leaves, const CpRange& range, ostream& out,
+                                     uint32_t& tableOffset, vector<PathOffset>& offsets,
+                                     const HyphenBuildOptions& options, uint32_t& sharedEnd)
 {
     // unique rules have no offset
-    WriteUniqueRules(out);
+    WriteUniqueRules(out, options);
     // shared nodes offset needs to be stored to header
     auto sharedOffset = CheckSharedLeaves(out, leaves);
+    sharedEnd = static_cast<uint32_t>(out.tellp());
 
     vector<Path*> bigOnes;
     bool hasDirect{false};
@@ -794,11 +1172,11 @@ static bool WriteLeavePathsToOutFile(map<uint16_t, PatternHolder>& leaves, const
                 continue;
             }
             uint32_t end{0};
-            uint16_t value = path.second.Write(out, tableOffset, &end);
+            uint16_t value = WriteTopLevelPath(path.second, out, tableOffset, end);
             uint16_t offset = value & 0x3fff;
             uint32_t type = value & 0x0000c000;
             uint16_t code = path.first;
-            cout << "direct:" << hex << static_cast<int>(code) << ": " << tableOffset << " : " << end << " type " <<
+            Log() << "direct:" << hex << static_cast<int>(code) << ": " << tableOffset << " : " << end << " type " <<
                 type << endl;
             tableOffset = end;
             offsets.push_back(PathOffset(offset, end, type, code));
@@ -809,21 +1187,22 @@ static bool WriteLeavePathsToOutFile(map<uint16_t, PatternHolder>& leaves, const
     // write distinc code points array after the direct ones
     for (auto path : bigOnes) {
         uint32_t end{0};
-        uint16_t value = path->Write(out, tableOffset, &end);
+        uint16_t value = WriteTopLevelPath(*path, out, tableOffset, end);
         uint16_t offset = value & 0x3fff;
         uint32_t type = value & 0x0000c000;
         uint16_t code = path->code;
-        cout << "distinct: 0x" << hex << static_cast<int>(code) << ": " << hex << tableOffset << " : " << end <<
+        Log() << "distinct: 0x" << hex << static_cast<int>(code) << ": " << hex << tableOffset << " : " << end <<
             " type " << type << dec << endl;
         tableOffset = end;
         offsets.push_back(PathOffset(offset, end, type, code));
     }
 
+    Log() << "shared subtrees: " << dec << g_build->sharedSubtreeCount << endl;
     offsets.push_back(PathOffset(sharedOffset, 0, 0, 0));
     return hasDirect;
 }
 
-void ProcessDirectPointingValues(std::vector<PathOffset>::const_iterator& lastEffectiveIterator, std::ofstream& out,
+void ProcessDirectPointingValues(std::vector<PathOffset>::const_iterator& lastEffectiveIterator, std::ostream& out,
                                  WriteOffestsParams& params, uint32_t& currentEnd, bool hasDirect)
 {
     for (size_t i = params.fCpRange.minimumCp; i <= params.fCpRange.maximumCp; i++) {
@@ -841,21 +1220,21 @@ void ProcessDirectPointingValues(std::vector<PathOffset>::const_iterator& lastEf
             uint32_t dummy{0};
             Path::WritePacked(dummy, out);
             Path::WritePacked(currentEnd, out);
-            std::cout << "Direct: padded " << std::endl;
+            Log() << "Direct: padded " << std::endl;
             continue;
         }
         lastEffectiveIterator = iterator;
         uint32_t type = static_cast<uint32_t>(iterator->type);
         uint32_t bytes = static_cast<uint32_t>(iterator->offset) | type << 16;
         currentEnd = iterator->end;
-        std::cout << "Direct: " << std::hex << "o: 0x" << iterator->offset << " e: 0x" << iterator->end << " t: 0x" <<
+        Log() << "Direct: " << std::hex << "o: 0x" << iterator->offset << " e: 0x" << iterator->end << " t: 0x" <<
             type << " c: 0x" << bytes << std::endl;
         Path::WritePacked(bytes, out);
         Path::WritePacked(currentEnd, out);
     }
 }
 
-void ProcessDistinctCodepoints(std::vector<PathOffset>::const_iterator& lastEffectiveIterator, std::ofstream& out,
+void ProcessDistinctCodepoints(std::vector<PathOffset>::const_iterator& lastEffectiveIterator, std::ostream& out,
                                WriteOffestsParams& params, std::vector<uint16_t>& mappings, uint32_t& currentEnd)
 {
     auto pos = params.fCpRange.maximumCp;
@@ -871,7 +1250,7 @@ void ProcessDistinctCodepoints(std::vector<PathOffset>::const_iterator& lastEffe
         uint32_t type = static_cast<uint32_t>(lastEffectiveIterator->type);
         uint32_t bytes = static_cast<uint32_t>(lastEffectiveIterator->offset) | type << 16;
         currentEnd = lastEffectiveIterator->end;
-        std::cout << "Distinct: " << std::hex << "code: 0x" << static_cast<int>(lastEffectiveIterator->code) <<
+        Log() << "Distinct: " << std::hex << "code: 0x" << static_cast<int>(lastEffectiveIterator->code) <<
             " o: 0x" << lastEffectiveIterator->offset << " e: 0x" << lastEffectiveIterator->end << " t: " << type <<
             " c: 0x" << bytes << std::endl;
         Path::WritePacked(bytes, out);
@@ -880,7 +1259,7 @@ void ProcessDistinctCodepoints(std::vector<PathOffset>::const_iterator& lastEffe
     }
 }
 
-static void WriteOffestsToOutFile(ofstream& out, WriteOffestsParams& params, uint32_t currentEnd, bool hasDirect)
+static void WriteOffestsToOutFile(ostream& out, WriteOffestsParams& params, uint32_t currentEnd, bool hasDirect)
 {
     if (!params.fOffsets.empty() && params.fOffsets.rbegin()->code == 0) {
         params.fCommonNodeOffset = params.fOffsets.rbegin()->offset;
@@ -913,6 +1292,272 @@ static void WriteOffestsToOutFile(ofstream& out, WriteOffestsParams& params, uin
     }
 }
 
+// HyphenCodeFilter of the patterns as 32 bit words, empty when it would not fit or when a
+// pattern has no code but the delimiter, as nothing could be skipped then
+static vector<uint32_t> BuildCodeFilter(const map<uint16_t, PatternHolder>& leaves)
+{
+    constexpr uint32_t wordBits = 32;
+    constexpr size_t headerWords = 2;
+    uint16_t first = UINT16_MAX;
+    uint16_t last = 0;
+    for (const auto& leaf : leaves) {
+        for (const auto& pattern : leaf.second.patterns) {
+            bool hasLetter = false;
+            for (uint16_t code : pattern.first) {
+                if (code != HYPHEN_DELIMITER_CODE) {
+                    first = min(first, code);
+                    last = max(last, code);
+                    hasLetter = true;
+                }
+            }
+            if (!hasLetter) {
+                return {};
+            }
+        }
+    }
+    if (first > last || (last - first) / wordBits + 1 > MAX_CODE_FILTER_WORDS) {
+        return {};
+    }
+    const uint32_t words = (last - first) / wordBits + 1;
+    uint16_t flags = 0;
+    vector<uint32_t> filter(headerWords + HYPHEN_BASE_CODE_SHIFT * words, 0);
+    for (const auto& leaf : leaves) {
+        for (const auto& pattern : leaf.second.patterns) {
+            for (uint16_t code : pattern.first) {
+                if (code != HYPHEN_DELIMITER_CODE) {
+                    filter[headerWords + (code - first) / wordBits] |= 1u << ((code - first) % wordBits);
+                }
+            }
+            uint16_t end = pattern.first.back();
+            if (end == HYPHEN_DELIMITER_CODE) {
+                flags |= CODE_FILTER_DELIMITER_ENDS;
+            } else {
+                filter[headerWords + words + (end - first) / wordBits] |= 1u << ((end - first) % wordBits);
+            }
+        }
+    }
+    filter[0] = first | (words << SHIFT_BITS_16);
+    filter[1] = flags;
+    return filter;
+}
+
+// Aho-Corasick automaton over all the patterns in their natural order,
+// matching is done in a single pass from the beginning of the word
+struct AcBuildState {
+    map<uint16_t, uint32_t> next;
+    uint32_t fail{0};
+    uint32_t outputLink{0};
+    uint16_t depth{0};
+    const vector<uint8_t>* rule{nullptr};
+};
+
+static void InsertAcPattern(vector<AcBuildState>& states, const vector<uint16_t>& codepoints,
+                            const vector<uint8_t>* rule)
+{
+    uint32_t state = 0;
+    for (auto code : codepoints) {
+        auto ite = states[state].next.find(code);
+        if (ite == states[state].next.end()) {
+            states.emplace_back();
+            states.back().depth = states[state].depth + 1;
+            ite = states[state].next.emplace(code, static_cast<uint32_t>(states.size() - 1)).first;
+        }
+        state = ite->second;
+    }
+    states[state].rule = rule;
+}
+
+// Resolve fail and output links in breadth first order, returns the states in that order
+static vector<uint32_t> ResolveAcLinks(vector<AcBuildState>& states)
+{
+    vector<uint32_t> order;
+    queue<uint32_t> pending;
+    pending.push(0);
+    while (!pending.empty()) {
+        uint32_t state = pending.front();
+        pending.pop();
+        order.push_back(state);
+        for (const auto& edge : states[state].next) {
+            uint32_t child = edge.second;
+            uint32_t fail = states[state].fail;
+            if (state != 0) {
+                while (fail != 0 && states[fail].next.count(edge.first) == 0) {
+                    fail = states[fail].fail;
+                }
+                auto ite = states[fail].next.find(edge.first);
+                fail = (ite != states[fail].next.end()) ? ite->second : 0;
+            }
+            states[child].fail = fail;
+            states[child].outputLink = states[fail].rule ? fail : states[fail].outputLink;
+            pending.push(child);
+        }
+    }
+    return order;
+}
+
+static void WriteAcRules(ostream& out, const vector<AcBuildState>& states, const HyphenBuildOptions& options,
+                         map<vector<uint8_t>, uint32_t>& ruleOffsets)
+{
+    uint32_t start = static_cast<uint32_t>(out.tellp());
+    for (const auto& state : states) {
+        if (state.rule == nullptr || ruleOffsets.count(*state.rule) != 0) {
+            continue;
+        }
+        ruleOffsets[*state.rule] = static_cast<uint32_t>(out.tellp()) - start;
+        if (options.nibbleRules) {
+            Path::WritePackedNibbles(*state.rule, out);
+        } else {
+            Path::WritePacked(*state.rule, out, false);
+        }
+    }
+}
+
+static void WriteAhoCorasick(const map<uint16_t, PatternHolder>& leaves, ostream& out,
+                             const HyphenBuildOptions& options)
+{
+    vector<AcBuildState> states(1);
+    for (const auto& leave : leaves) {
+        for (const auto& pattern : leave.second.patterns) {
+            InsertAcPattern(states, pattern.first, &pattern.second);
+        }
+    }
+    vector<uint32_t> order = ResolveAcLinks(states);
+    vector<uint32_t> ids(states.size(), 0);
+    for (size_t i = 0; i < order.size(); i++) {
+        ids[order[i]] = static_cast<uint32_t>(i);
+    }
+
+    AcHeader header{HYPHEN_MAGIC, HYPHEN_MAGIC_AHO_CORASICK, 0, static_cast<uint32_t>(states.size()), 0, 0, 0, 0,
+                    AHO_CORASICK_VERSION};
+    if (options.nibbleRules) {
+        header.flags = HYPHEN_FLAG_NIBBLE_RULES;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    header.rules = static_cast<uint32_t>(out.tellp());
+    map<vector<uint8_t>, uint32_t> ruleOffsets;
+    WriteAcRules(out, states, options, ruleOffsets);
+
+    vector<AcState> packed;
+    vector<uint16_t> codes;
+    vector<uint32_t> targets;
+    for (auto id : order) {
+        const auto& state = states[id];
+        AcState acState{static_cast<uint32_t>(codes.size()), ids[state.fail], 0, ids[state.outputLink],
+                        static_cast<uint16_t>(state.next.size()), static_cast<uint8_t>(state.depth), 0};
+        if (state.rule) {
+            acState.rule = ruleOffsets[*state.rule];
+            acState.ruleCount = static_cast<uint8_t>(state.rule->size());
+        }
+        for (const auto& edge : state.next) {
+            codes.push_back(edge.first);
+            targets.push_back(ids[edge.second]);
+        }
+        packed.push_back(acState);
+    }
+    if ((codes.size() & 0x1) != 0) {
+        codes.push_back(0); // keep the targets aligned
+    }
+
+    header.states = static_cast<uint32_t>(out.tellp());
+    out.write(reinterpret_cast<const char*>(packed.data()), packed.size() * sizeof(AcState));
+    header.edgeCodes = static_cast<uint32_t>(out.tellp());
+    out.write(reinterpret_cast<const char*>(codes.data()), codes.size() * sizeof(uint16_t));
+    header.edgeTargets = static_cast<uint32_t>(out.tellp());
+    out.write(reinterpret_cast<const char*>(targets.data()), targets.size() * sizeof(uint32_t));
+
+    out.seekp(ios::beg);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    Log() << "Aho-Corasick states: " << dec << states.size() << " edges: " << targets.size() <<
+        " rules: " << ruleOffsets.size() << endl;
+}
+
+static bool DeflateChunk(const vector<uint8_t>& data, HzChunk& chunk, vector<uint8_t>& compressed)
+{
+    uLongf size = compressBound(chunk.size);
+    vector<uint8_t> buffer(size);
+    if (compress2(buffer.data(), &size, data.data() + chunk.offset, chunk.size, Z_BEST_COMPRESSION) != Z_OK) {
+        cerr << "failed to deflate subtree at " << hex << chunk.offset << endl;
+        return false;
+    }
+    chunk.compressed = static_cast<uint32_t>(compressed.size());
+    chunk.compressedSize = static_cast<uint32_t>(size);
+    compressed.insert(compressed.end(), buffer.begin(), buffer.begin() + size);
+    while ((compressed.size() % PADDING_SIZE) != 0) {
+        compressed.push_back(0);
+    }
+    return true;
+}
+
+// Rewrite a finished trie binary as a compressed container, prefixEnd being the
+// end of the rules and shared nodes that are needed by every subtree
+static int32_t CompressOutFile(const string& fileName, uint32_t prefixEnd)
+{
+    ifstream input(fileName, ios::binary);
+    vector<uint8_t> data((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+    input.close();
+    constexpr size_t TOC_POS = 4;
+    constexpr size_t MAPPINGS_POS = 8;
+    if (data.size() < FULL_TALBLE * BYTES_PRE_WORD) {
+        cerr << "unexpected binary size, not compressing" << endl;
+        return FAILED;
+    }
+    uint32_t toc = *reinterpret_cast<const uint32_t*>(data.data() + TOC_POS);
+    uint32_t mappings = *reinterpret_cast<const uint32_t*>(data.data() + MAPPINGS_POS);
+    if (toc > mappings || mappings > data.size()) {
+        cerr << "unexpected binary layout, not compressing" << endl;
+        return FAILED;
+    }
+
+    // toc words: initial end followed by (value, end) pairs, subtrees are written in toc order
+    // so the data of an entry starts where the previous one ended
+    const uint32_t* tocWords = reinterpret_cast<const uint32_t*>(data.data() + toc);
+    size_t entries = ((mappings - toc) / sizeof(uint32_t) - 1) / HYPHEN_BASE_CODE_SHIFT;
+    vector<HzChunk> chunks(entries, HzChunk{0, 0, 0, 0});
+    vector<uint8_t> compressed;
+    uint32_t written = prefixEnd;
+    for (size_t i = 0; i < entries; i++) {
+        uint32_t begin = written;
+        uint32_t end = min(tocWords[i * HYPHEN_BASE_CODE_SHIFT + HYPHEN_BASE_CODE_SHIFT] * 2, toc);
+        if (end <= begin) {
+            continue;
+        }
+        written = end;
+        chunks[i].offset = begin;
+        chunks[i].size = end - begin;
+        if (!DeflateChunk(data, chunks[i], compressed)) {
+            return FAILED;
+        }
+    }
+
+    HzHeader header{HYPHEN_MAGIC, HYPHEN_MAGIC_COMPRESSED, 0, static_cast<uint32_t>(data.size()), prefixEnd, toc,
+                    static_cast<uint32_t>(entries), 0, COMPRESSED_VERSION};
+    uint32_t prefixSize = (prefixEnd + PADDING_SIZE - 1) & ~(PADDING_SIZE - 1);
+    uint32_t tailSize = (static_cast<uint32_t>(data.size()) - toc + PADDING_SIZE - 1) & ~(PADDING_SIZE - 1);
+    header.chunks = sizeof(header) + prefixSize + tailSize;
+    uint32_t dataStart = header.chunks + static_cast<uint32_t>(entries * sizeof(HzChunk));
+    for (auto& chunk : chunks) {
+        chunk.compressed += dataStart;
+    }
+
+    if (dataStart + compressed.size() >= data.size()) {
+        Log() << "compressed container would not be smaller, keeping " << fileName << endl;
+        return SUCCEED;
+    }
+
+    data.resize(toc + tailSize, 0);
+    ofstream out(fileName, ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(data.data()), prefixEnd);
+    uint32_t padding = 0;
+    out.write(reinterpret_cast<const char*>(&padding), prefixSize - prefixEnd);
+    out.write(reinterpret_cast<const char*>(data.data() + toc), tailSize);
+    out.write(reinterpret_cast<const char*>(chunks.data()), chunks.size() * sizeof(HzChunk));
+    out.write(reinterpret_cast<const char*>(compressed.data()), compressed.size());
+    Log() << "compressed " << dec << header.originalSize << " to " << out.tellp() << " bytes" << endl;
+    return out.good() ? SUCCEED : FAILED;
+}
+
 std::string GetFileNameWithoutSuffix(const std::string& filePath)
 {
     size_t lastSlashPos = filePath.find_last_of("/\\");
@@ -924,53 +1569,112 @@ std::string GetFileNameWithoutSuffix(const std::string& filePath)
 void CreateDirectory(const std::string& folderPath)
 {
     if (mkdir(folderPath.c_str(), 0755) == 0) { // 0755 means the owner has read, write, and execute permissions,
-        std::cout << "Directory created successfully: " << folderPath << std::endl;
+        Log() << "Directory created successfully: " << folderPath << std::endl;
     } else {
-        std::cout << "Directory already exists: " << folderPath << std::endl;
+        Log() << "Directory already exists: " << folderPath << std::endl;
     }
 }
 
-void HyphenProcessor::Proccess(const std::string& filePath, const std::string& outFilePath) const
+// Section boundaries of a written file, in bytes
+struct FileSections {
+    uint32_t rulesEnd{0};
+    uint32_t sharedEnd{0};
+    uint32_t toc{0};
+    uint32_t mappings{0};
+    uint32_t codeFilter{0};
+    uint32_t end{0};
+};
+
+static void WriteHistogram(ostream& out, const char* name, const map<size_t, size_t>& histogram)
 {
-    map<string, vector<string>> sections;
-    if (ResolveSectionsFromFile(filePath, sections) != SUCCEED) {
-        return;
+    out << "  \"" << name << "\": {";
+    for (auto ite = histogram.cbegin(); ite != histogram.cend(); ++ite) {
+        out << (ite == histogram.cbegin() ? "" : ", ") << "\"" << ite->first << "\": " << ite->second;
     }
+    out << "},\n";
+}
 
-    char resolvedPath[PATH_MAX] = {0};
-    if (outFilePath.size() > PATH_MAX) {
-        cout << "The file name is too long" << endl;
+static void WriteStats(const string& statsPath, const string& language, const FileSections& sections,
+                       const HyphenBuildOptions& options)
+{
+    constexpr uint32_t headerSize = FULL_TALBLE * sizeof(uint32_t);
+    constexpr uint32_t maxNodeOffset = 0x3fff;
+    constexpr uint32_t maxCommonNodeOffset = 0xffff;
+    ofstream out(statsPath, ios::trunc);
+    out << "{\n  \"language\": \"" << language << "\",\n  \"nibble_rules\": " <<
+        (options.nibbleRules ? "true" : "false") << ",\n  \"radix_edges\": " <<
+        (options.radixEdges ? "true" : "false") << ",\n  \"compressed\": " << (options.compress ? "true" : "false") <<
+        ",\n  \"frequency_order\": " << (options.corpus.empty() ? "false" : "true") << ",\n";
+    out << "  \"bytes\": {\"header\": " << headerSize << ", \"rules\": " << sections.rulesEnd - headerSize <<
+        ", \"shared_leaves\": " << sections.sharedEnd - sections.rulesEnd << ", \"nodes\": " <<
+        sections.toc - sections.sharedEnd << ", \"toc\": " << sections.mappings - sections.toc <<
+        ", \"mappings\": " << sections.codeFilter - sections.mappings << ", \"code_filter\": " <<
+        sections.end - sections.codeFilter << ", \"total\": " << sections.end << "},\n";
+    out << "  \"patterns\": " << g_build->stats.patterns << ",\n  \"duplicate_patterns\": " <<
+        g_build->stats.duplicatePatterns <<
+        ",\n  \"conflicting_duplicates\": " << g_build->stats.conflictingDuplicates << ",\n  \"unique_rules\": " <<
+        g_build->allRules.size() << ",\n  \"paths\": " << g_build->pathCount << ",\n  \"unique_subtrees\": " <<
+        g_build->subtreeIds.size() << ",\n  \"shared_subtree_references\": " << g_build->sharedSubtreeCount <<
+        ",\n  \"dropped_nodes\": " << g_build->droppedCount << ",\n  \"dropped_patterns\": " <<
+        g_build->droppedPatterns << ",\n";
+    const auto& types = g_build->stats.nodeTypes;
+    out << "  \"node_types\": {\"pattern\": " << types[0] << ", \"linear\": " << types[1] << ", \"pairs\": " <<
+        types[2] << ", \"direct\": " << types[3] << "},\n";
+    WriteHistogram(out, "fan_out", g_build->stats.fanOut);
+    WriteHistogram(out, "linear_chain_length", g_build->stats.linearChains);
+    WriteHistogram(out, "radix_edge_length", g_build->stats.radixEdges);
+    // room left in the fixed width offsets before nodes get dropped or the build fails
+    out << "  \"headroom\": {\"node_offset\": " << static_cast<int64_t>(maxNodeOffset) - g_build->stats.maxNodeOffset <<
+        ", \"rule_offset\": " << static_cast<int64_t>(RULE_ADDRESS_SPACE) - 1 - g_build->stats.maxRulePos <<
+        ", \"common_node_offset\": " << static_cast<int64_t>(maxCommonNodeOffset) - (sections.rulesEnd >> 1) <<
+        "}\n}\n";
+    if (!out.good()) {
+        cerr << "failed to write " << statsPath << endl;
         return;
     }
-    if (realpath(outFilePath.c_str(), resolvedPath) == nullptr) {
-        CreateDirectory(resolvedPath);
-    }
-
-    vector<vector<uint16_t>> utf16Patterns;
-    ResolvePatternsFromSections(sections, utf16Patterns);
+    Log() << "stats: " << statsPath << endl;
+}
 
+// Compile the patterns with the build state of the calling thread, the binary is written
+// from the current position of out on. Trie binaries report their sections.
+static int32_t WriteBinary(const vector<vector<uint16_t>>& utf16Patterns, const HyphenBuildOptions& options,
+                           ostream& out, FileSections& fileSections)
+{
     map<uint16_t, PatternHolder> leaves;
-    ResolveLeavesFromPatterns(utf16Patterns, leaves);
+    ResolveLeavesFromPatterns(utf16Patterns, leaves, options);
+    if (options.ahoCorasick) {
+        WriteAhoCorasick(leaves, out, options);
+        return out.good() ? SUCCEED : FAILED;
+    }
 
+    const vector<uint32_t> codeFilter = BuildCodeFilter(leaves);
     CpRange range = {0, 0};
     int countPat = 0;
     BreakLeavesIntoPaths(leaves, range, countPat);
+    g_build->radixEdges = options.radixEdges;
+    if (!options.corpus.empty()) {
+        if (CountCorpusVisits(options.corpus, leaves) != SUCCEED) {
+            return FAILED;
+        }
+        g_build->frequencyOrder = true;
+    }
 
-    string filename = GetFileNameWithoutSuffix(filePath);
-    std::cout << "output file: " << (outFilePath + "/" + filename + ".hpb") << std::endl;
-    ofstream out((outFilePath + "/" + filename + ".hpb"), ios::binary);
     uint32_t tableOffset = InitOutFileHead(out);
     vector<PathOffset> offsets;
     uint32_t toc = 0;
 
-    bool hasDirect = WriteLeavePathsToOutFile(leaves, range, out, tableOffset, offsets);
+    uint32_t sharedEnd = 0;
+    bool hasDirect = WriteLeavePathsToOutFile(leaves, range, out, tableOffset, offsets, options, sharedEnd);
+    if (g_build->failed) {
+        return FAILED;
+    }
     toc = static_cast<uint32_t>(out.tellp());
     if ((toc % 0x4) != 0) {
         out.write(reinterpret_cast<const char*>(&toc), toc % 0x4);
         toc = static_cast<uint32_t>(out.tellp());
     }
     // and main table offsets
-    cout << "Produced " << offsets.size() << " paths with z: " << toc << endl;
+    Log() << "Produced " << offsets.size() << " paths with z: " << toc << endl;
 
     uint32_t currentEnd = FULL_TALBLE * 2; // initial offset (in 16 bits)
     Path::WritePacked(currentEnd, out);
@@ -978,25 +1682,522 @@ void HyphenProcessor::Proccess(const std::string& filePath, const std::string& o
     uint32_t mappingsPos = 0;
     WriteOffestsParams writeOffestsParams(offsets, mappingsPos, range);
     WriteOffestsToOutFile(out, writeOffestsParams, currentEnd, hasDirect);
-    if (FormatOutFileHead(out, writeOffestsParams, toc) != SUCCEED) {
-        cout << "DONE: With " << to_string(countPat) << "patterns (8bit)" << endl;
+    uint32_t filterPos = static_cast<uint32_t>(out.tellp());
+    if (!codeFilter.empty()) {
+        uint32_t padding = 0;
+        out.write(reinterpret_cast<const char*>(&padding), (PADDING_SIZE - filterPos % PADDING_SIZE) % PADDING_SIZE);
+        filterPos = static_cast<uint32_t>(out.tellp());
+        out.write(reinterpret_cast<const char*>(codeFilter.data()), codeFilter.size() * sizeof(uint32_t));
+    }
+    fileSections = {static_cast<uint32_t>(writeOffestsParams.fCommonNodeOffset) << 1, sharedEnd, toc,
+                    writeOffestsParams.fMappingsPos, filterPos, static_cast<uint32_t>(out.tellp())};
+    if (FormatOutFileHead(out, writeOffestsParams, toc, options, !codeFilter.empty()) != SUCCEED) {
+        Log() << "DONE: With " << to_string(countPat) << "patterns (8bit)" << endl;
+    }
+    return !g_build->failed && out.good() ? SUCCEED : FAILED;
+}
+
+// Same as WriteBinary, into memory
+static int32_t BuildBinary(const vector<vector<uint16_t>>& utf16Patterns, const HyphenBuildOptions& options,
+                           vector<uint8_t>& binary, FileSections& fileSections)
+{
+    ostringstream out(ios::binary);
+    if (WriteBinary(utf16Patterns, options, out, fileSections) != SUCCEED) {
+        return FAILED;
+    }
+    const string data = out.str();
+    binary.assign(data.cbegin(), data.cend());
+    return SUCCEED;
+}
+
+int32_t HyphenProcessor::Proccess(const std::string& filePath, const std::string& outFilePath) const
+{
+    map<string, vector<string>> sections;
+    if (ResolveSectionsFromFile(filePath, sections) != SUCCEED) {
+        return FAILED;
+    }
+
+    char resolvedPath[PATH_MAX] = {0};
+    if (outFilePath.size() > PATH_MAX) {
+        Log() << "The file name is too long" << endl;
+        return FAILED;
+    }
+    if (realpath(outFilePath.c_str(), resolvedPath) == nullptr) {
+        CreateDirectory(resolvedPath);
+    }
+
+    vector<vector<uint16_t>> utf16Patterns;
+    ResolvePatternsFromSections(sections, utf16Patterns);
+
+    BuildState state;
+    BuildScope scope(state);
+    string filename = GetFileNameWithoutSuffix(filePath);
+    const string hpbPath = outFilePath + "/" + filename + ".hpb";
+    if (fOptions.ahoCorasick && fOptions.stats) {
+        Log() << "no stats for Aho-Corasick output" << endl;
+    }
+    Log() << "output file: " << hpbPath << std::endl;
+    ofstream out(hpbPath, ios::binary);
+    FileSections fileSections;
+    if (WriteBinary(utf16Patterns, fOptions, out, fileSections) != SUCCEED) {
+        cerr << "failed to build " << filePath << endl;
+        return FAILED;
+    }
+    out.close();
+    if (fOptions.ahoCorasick) {
+        return SUCCEED;
+    }
+    if (fOptions.stats) {
+        WriteStats(outFilePath + "/" + filename + ".stats.json", filename, fileSections, fOptions);
+    }
+    if (fOptions.compress && CompressOutFile(hpbPath, fileSections.sharedEnd) != SUCCEED) {
+        cerr << "failed to compress " << hpbPath << endl;
+        return FAILED;
+    }
+    return SUCCEED;
+}
+
+std::shared_ptr<const HpbImage> HpbBuilder::Build(const std::vector<std::string>& patterns,
+                                                  const std::vector<std::string>& exceptions) const
+{
+    if (fOptions.compress || fOptions.stats) {
+        cerr << "compression and stats are for files, not for images" << endl;
+        return nullptr;
+    }
+    BuildState state;
+    state.verbose = false;
+    BuildScope scope(state);
+    vector<vector<uint16_t>> utf16Patterns;
+    ResolvePatterns(patterns, exceptions, utf16Patterns);
+    vector<uint8_t> binary;
+    FileSections fileSections;
+    if (utf16Patterns.empty() || BuildBinary(utf16Patterns, fOptions, binary, fileSections) != SUCCEED) {
+        cerr << "failed to build the dictionary image" << endl;
+        return nullptr;
+    }
+    // zero padded to the alignment, reads of a whole block never leave the allocation
+    const size_t size = (binary.size() + HpbImage::ALIGNMENT - 1) & ~(HpbImage::ALIGNMENT - 1);
+    std::shared_ptr<HpbImage> image(new HpbImage());
+    image->fData.reset(static_cast<uint8_t*>(aligned_alloc(HpbImage::ALIGNMENT, size)));
+    if (!image->fData) {
+        cerr << "failed to allocate " << size << " bytes for the dictionary image" << endl;
+        return nullptr;
+    }
+    memcpy(image->fData.get(), binary.data(), binary.size());
+    memset(image->fData.get() + binary.size(), 0, size - binary.size());
+    image->fSize = binary.size();
+    return image;
+}
+
+static int32_t CollectRules(const string& filePath, const HyphenBuildOptions& options, set<vector<uint8_t>>& rules)
+{
+    map<string, vector<string>> sections;
+    if (ResolveSectionsFromFile(filePath, sections) != SUCCEED) {
+        return FAILED;
+    }
+    vector<vector<uint16_t>> utf16Patterns;
+    ResolvePatternsFromSections(sections, utf16Patterns);
+    map<uint16_t, PatternHolder> leaves;
+    BuildState state;
+    BuildScope scope(state);
+    ResolveLeavesFromPatterns(utf16Patterns, leaves, options);
+    for (const auto& rule : g_build->allRules) {
+        rules.insert(rule.first);
+    }
+    return SUCCEED;
+}
+
+static size_t RuleTableSize(const set<vector<uint8_t>>& rules, const HyphenBuildOptions& options)
+{
+    size_t size = FULL_TALBLE * BYTES_PRE_WORD;
+    for (const auto& rule : rules) {
+        size += options.nibbleRules ? rule.size() / HYPHEN_BASE_CODE_SHIFT : rule.size();
+    }
+    return size;
+}
+
+// Put every language to the group it shares most rules with, as long as the
+// merged table stays addressable
+static vector<size_t> GroupRules(const vector<set<vector<uint8_t>>>& languageRules,
+                                 vector<set<vector<uint8_t>>>& groups, const HyphenBuildOptions& options)
+{
+    vector<size_t> assignment;
+    for (const auto& rules : languageRules) {
+        size_t best = groups.size();
+        size_t bestShared = 0;
+        for (size_t i = 0; i < groups.size(); i++) {
+            set<vector<uint8_t>> merged = groups[i];
+            merged.insert(rules.cbegin(), rules.cend());
+            size_t shared = RuleTableSize(groups[i], options) + RuleTableSize(rules, options) -
+                RuleTableSize(merged, options);
+            if (shared > bestShared && RuleTableSize(merged, options) <= RULE_ADDRESS_SPACE) {
+                best = i;
+                bestShared = shared;
+            }
+        }
+        if (best == groups.size()) {
+            groups.push_back(rules);
+        } else {
+            groups[best].insert(rules.cbegin(), rules.cend());
+        }
+        assignment.push_back(best);
+    }
+    return assignment;
+}
+
+struct BundlePart {
+    string name;
+    vector<uint8_t> data;
+    uint32_t split{0};
+    size_t table{0};
+    size_t dropped{0};
+};
+
+// Build one language with the given rule table
+static int32_t BuildBundlePart(const string& filePath, const HyphenBuildOptions& options,
+                               const set<vector<uint8_t>>& rules, BundlePart& part)
+{
+    map<string, vector<string>> sections;
+    if (ResolveSectionsFromFile(filePath, sections) != SUCCEED) {
+        return FAILED;
     }
+    vector<vector<uint16_t>> utf16Patterns;
+    ResolvePatternsFromSections(sections, utf16Patterns);
+    BuildState state;
+    BuildScope scope(state);
+    for (const auto& rule : rules) {
+        g_build->allRules[rule] = Rule();
+    }
+    part.name = GetFileNameWithoutSuffix(filePath);
+    FileSections fileSections;
+    if (BuildBinary(utf16Patterns, options, part.data, fileSections) != SUCCEED) {
+        part.data.clear();
+    }
+    part.dropped = g_build->droppedCount;
+    if (part.data.size() < FULL_TALBLE * BYTES_PRE_WORD) {
+        cerr << "failed to build " << filePath << endl;
+        return FAILED;
+    }
+    // rules end where the common nodes begin
+    constexpr size_t versionPos = 12;
+    part.split = (*reinterpret_cast<const uint32_t*>(part.data.data() + versionPos) & 0xffff) *
+        HYPHEN_BASE_CODE_SHIFT;
+    return SUCCEED;
+}
+
+static uint32_t AlignUp(uint32_t offset, uint32_t alignment)
+{
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+static int32_t WriteBundle(const string& bundlePath, vector<BundlePart>& parts, const vector<vector<uint8_t>>& tables)
+{
+    constexpr uint32_t imageAlignment = 16;
+    uint32_t offset = static_cast<uint32_t>(sizeof(HbHeader) + parts.size() * sizeof(HbLanguage));
+    vector<uint32_t> tableOffsets;
+    for (const auto& table : tables) {
+        offset = AlignUp(offset, PADDING_SIZE);
+        tableOffsets.push_back(offset);
+        offset += static_cast<uint32_t>(table.size());
+    }
+    vector<uint8_t> bundle(offset, 0);
+    HbHeader header{HYPHEN_MAGIC, HYPHEN_MAGIC_BUNDLE, 0, static_cast<uint32_t>(parts.size()),
+                    static_cast<uint32_t>(sizeof(HbHeader)), static_cast<uint32_t>(tables.size()), BUNDLE_VERSION};
+    memcpy(bundle.data(), &header, sizeof(header));
+    for (size_t i = 0; i < tables.size(); i++) {
+        copy(tables[i].cbegin(), tables[i].cend(), bundle.begin() + tableOffsets[i]);
+    }
+    for (size_t i = 0; i < parts.size(); i++) {
+        auto& part = parts[i];
+        // the image is addressed from 'image - split', keep that aligned
+        uint32_t image = AlignUp(static_cast<uint32_t>(bundle.size()) - part.split, imageAlignment) + part.split;
+        bundle.resize(image, 0);
+        bundle.insert(bundle.end(), part.data.cbegin() + part.split, part.data.cend());
+        HbLanguage language{};
+        part.name.copy(language.name, BUNDLE_NAME_SIZE - 1);
+        memcpy(language.header, part.data.data(), sizeof(language.header));
+        language.rules = tableOffsets[part.table];
+        language.image = image;
+        language.split = part.split;
+        language.size = static_cast<uint32_t>(part.data.size());
+        memcpy(bundle.data() + sizeof(HbHeader) + i * sizeof(HbLanguage), &language, sizeof(language));
+    }
+
+    ofstream out(bundlePath, ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(bundle.data()), bundle.size());
+    Log() << "bundle of " << dec << parts.size() << " languages and " << tables.size() << " rule tables: " <<
+        bundle.size() << " bytes" << endl;
+    return out.good() ? SUCCEED : FAILED;
+}
+
+int32_t HyphenProcessor::ProcessBundle(const std::vector<std::string>& filePaths, const std::string& bundlePath) const
+{
+    if (fOptions.ahoCorasick || fOptions.compress) {
+        cerr << "bundles hold plain trie binaries only" << endl;
+        return FAILED;
+    }
+    vector<set<vector<uint8_t>>> languageRules(filePaths.size());
+    for (size_t i = 0; i < filePaths.size(); i++) {
+        if (GetFileNameWithoutSuffix(filePaths[i]).size() >= BUNDLE_NAME_SIZE ||
+            CollectRules(filePaths[i], fOptions, languageRules[i]) != SUCCEED) {
+            cerr << "cannot bundle " << filePaths[i] << endl;
+            return FAILED;
+        }
+    }
+    vector<set<vector<uint8_t>>> groups;
+    vector<size_t> assignment = GroupRules(languageRules, groups, fOptions);
+
+    // build every language with the complete rule table of its group
+    vector<BundlePart> parts;
+    vector<vector<uint8_t>> tables;
+    map<size_t, size_t> groupTables;
+    for (size_t i = 0; i < filePaths.size(); i++) {
+        BundlePart part;
+        size_t group = assignment[i];
+        if (BuildBundlePart(filePaths[i], fOptions, groups[group], part) != SUCCEED) {
+            return FAILED;
+        }
+        // nodes beyond the offset range are dropped depending on the layout, languages
+        // hitting the limit keep exactly the layout of their standalone binary
+        if (part.dropped != 0 && groups[group].size() != languageRules[i].size()) {
+            Log() << "dropped nodes with the shared rules, " << filePaths[i] << " keeps its own rules" << endl;
+            group = groups.size() + i;
+            if (BuildBundlePart(filePaths[i], fOptions, languageRules[i], part) != SUCCEED) {
+                return FAILED;
+            }
+        }
+        // the table is the beginning of the binary without its header
+        vector<uint8_t> table(part.data.cbegin(), part.data.cbegin() + part.split);
+        fill(table.begin(), table.begin() + FULL_TALBLE * BYTES_PRE_WORD, 0);
+        auto ite = groupTables.find(group);
+        if (ite != groupTables.cend() && tables[ite->second] == table) {
+            part.table = ite->second;
+        } else {
+            // not expected, but a language can always keep a table of its own
+            part.table = tables.size();
+            tables.push_back(table);
+            groupTables.emplace(group, part.table);
+        }
+        parts.push_back(std::move(part));
+    }
+    return WriteBundle(bundlePath, parts, tables);
+}
+
+// e.g. "hyph-de-1996" to "MatchHyphDe1996"
+static string MatcherName(const string& language)
+{
+    string name = "Match";
+    bool upper = true;
+    for (char c : language) {
+        if (!isalnum(static_cast<unsigned char>(c))) {
+            upper = true;
+            continue;
+        }
+        name += upper ? static_cast<char>(toupper(static_cast<unsigned char>(c))) : c;
+        upper = false;
+    }
+    return name;
+}
+
+// levels of the node's rule, the pattern starts at target[i] and has the given length
+static void EmitLevels(ostream& out, const string& indent, const vector<uint8_t>& rules, size_t patternLength)
+{
+    for (size_t k = 0; k < rules.size(); k++) {
+        if (rules[k] == 0) {
+            continue;
+        }
+        string position = k == 0 ? "i" : "i + " + to_string(k);
+        if (k < patternLength) {
+            out << indent << "RaiseLevel(result[" << position << "], " << static_cast<int>(rules[k]) << ");\n";
+        } else {
+            out << indent << "if (" << position << " < length) {\n" << indent << "    RaiseLevel(result[" << position <<
+                "], " << static_cast<int>(rules[k]) << ");\n" << indent << "}\n";
+        }
+    }
+}
+
+// One function per distinct subtree, children are emitted first. Identical subtrees
+// get identical bodies and share the function.
+struct CodegenState {
+    ostringstream functions;
+    map<string, string> names; // body to function name
+};
+
+// the node matched target[i], its pattern starts at i and has the given length
+static string EmitNode(CodegenState& state, const Path& node, size_t patternLength)
+{
+    ostringstream body;
+    if (node.pattern) {
+        EmitLevels(body, "    ", *node.pattern, patternLength);
+    }
+    if (!node.paths.empty()) {
+        body << "    if (i == 0) {\n        return;\n    }\n    switch (target[i - 1]) {\n";
+        for (const auto& path : node.paths) {
+            string child = EmitNode(state, path.second, patternLength + 1);
+            body << "        case 0x" << hex << path.first << dec << ":\n            " << child <<
+                "(target, i - 1, length, result);\n            break;\n";
+        }
+        body << "        default:\n            break;\n    }\n";
+    }
+    auto ite = state.names.find(body.str());
+    if (ite != state.names.cend()) {
+        return ite->second;
+    }
+    string name = "Node" + to_string(state.names.size());
+    state.functions << "void " << name << "([[maybe_unused]] const uint16_t* target, size_t i, " <<
+        "[[maybe_unused]] size_t length, uint8_t* result)\n{\n" << body.str() << "}\n\n";
+    state.names.emplace(body.str(), name);
+    return name;
+}
+
+static int32_t EmitMatcher(const string& filePath, const string& language, const string& sourcePath,
+                           const HyphenBuildOptions& options)
+{
+    map<string, vector<string>> sections;
+    if (ResolveSectionsFromFile(filePath, sections) != SUCCEED) {
+        return FAILED;
+    }
+    vector<vector<uint16_t>> utf16Patterns;
+    ResolvePatternsFromSections(sections, utf16Patterns);
+    map<uint16_t, PatternHolder> leaves;
+    ResolveLeavesFromPatterns(utf16Patterns, leaves, options);
+    CpRange range = {0, 0};
+    int countPat = 0;
+    BreakLeavesIntoPaths(leaves, range, countPat);
+
+    CodegenState state;
+    ostringstream root;
+    for (const auto& leave : leaves) {
+        for (const auto& path : leave.second.paths) {
+            string node = EmitNode(state, path.second, 1);
+            root << "            case 0x" << hex << path.first << dec << ":\n                " << node <<
+                "(target, end, length, result);\n                break;\n";
+        }
+    }
+    ofstream out(sourcePath, ios::trunc);
+    out << "// Generated by hpb_transform --emit-cpp from " << language << ".tex, do not edit.\n\n" <<
+        "#include \"hyphen_generated.h\"\n\nnamespace OHOS::Hyphenate {\nnamespace {\n" << state.functions.str() <<
+        "} // namespace\n\nvoid " << MatcherName(language) <<
+        "(const uint16_t* target, size_t length, uint8_t* result)\n{\n" <<
+        "    for (size_t end = 0; end < length; end++) {\n        switch (target[end]) {\n" << root.str() <<
+        "            default:\n                break;\n        }\n    }\n}\n} // namespace OHOS::Hyphenate\n";
+    if (!out.good()) {
+        cerr << "failed to write " << sourcePath << endl;
+        return FAILED;
+    }
+    Log() << "generated " << sourcePath << " with " << state.names.size() << " functions for " << g_build->pathCount <<
+        " nodes" << endl;
+    return SUCCEED;
+}
+
+static int32_t EmitRegistry(const string& sourcePath, const vector<string>& languages)
+{
+    ofstream out(sourcePath, ios::trunc);
+    out << "// Generated by hpb_transform --emit-cpp, do not edit.\n\n#include \"hyphen_generated.h\"\n\n" <<
+        "namespace OHOS::Hyphenate {\n";
+    for (const auto& language : languages) {
+        out << "void " << MatcherName(language) << "(const uint16_t* target, size_t length, uint8_t* result);\n";
+    }
+    out << "\nnamespace {\nconst HyphenGeneratedLanguage GENERATED_LANGUAGES[] = {\n";
+    for (const auto& language : languages) {
+        out << "    {\"" << language << "\", " << MatcherName(language) << "},\n";
+    }
+    out << "};\n} // namespace\n\n" <<
+        "HyphenGeneratedMatcher FindGeneratedMatcher(const std::string& language)\n{\n" <<
+        "    for (const auto& generated : GENERATED_LANGUAGES) {\n" <<
+        "        if (language == generated.language) {\n            return generated.matcher;\n        }\n" <<
+        "    }\n    return nullptr;\n}\n} // namespace OHOS::Hyphenate\n";
+    if (!out.good()) {
+        cerr << "failed to write " << sourcePath << endl;
+        return FAILED;
+    }
+    return SUCCEED;
+}
+
+int32_t HyphenProcessor::ProcessCodegen(const std::vector<std::string>& filePaths, const std::string& outDir) const
+{
+    CreateDirectory(outDir);
+    vector<string> languages;
+    for (const auto& filePath : filePaths) {
+        BuildState state;
+        BuildScope scope(state);
+        string language = GetFileNameWithoutSuffix(filePath);
+        if (EmitMatcher(filePath, language, outDir + "/hyphen_generated_" + language + ".cpp", fOptions) != SUCCEED) {
+            return FAILED;
+        }
+        languages.push_back(language);
+    }
+    return EmitRegistry(outDir + "/hyphen_generated_registry.cpp", languages);
 }
 } // namespace OHOS::Hyphenate
 
+#ifndef HPB_BUILDER_LIBRARY
+namespace {
+constexpr int32_t ARG_NUM = 2;
+
+int32_t ParseOptions(int argc, char** argv, OHOS::Hyphenate::HyphenBuildOptions& options, bool& bundle,
+                     bool& codegen)
+{
+    int32_t index = 1;
+    for (; index < argc && argv[index][0] == '-' && argv[index][1] == '-'; index++) {
+        string option = argv[index];
+        if (option == "--bundle") {
+            bundle = true;
+        } else if (option == "--emit-cpp") {
+            codegen = true;
+        } else if (option == "--corpus" && index + 1 < argc) {
+            options.corpus = argv[++index];
+        } else if (option == "--stats") {
+            options.stats = true;
+        } else if (option == "--nibble-rules") {
+            options.nibbleRules = true;
+        } else if (option == "--radix-edges") {
+            options.radixEdges = true;
+        } else if (option == "--aho-corasick") {
+            options.ahoCorasick = true;
+        } else if (option == "--compress") {
+            options.compress = true;
+        } else {
+            cout << "unknown option: " << option << endl;
+            return FAILED;
+        }
+    }
+    if (bundle || codegen ? argc - index < ARG_NUM : argc - index != ARG_NUM) {
+        return FAILED;
+    }
+    return index;
+}
+} // namespace
+
 int main(int argc, char** argv)
 {
-    if (argc != 3) { // 3: valid argument number
-        cout << "usage: './transform hyph-en-us.tex ./out/'" << endl;
+    OHOS::Hyphenate::HyphenBuildOptions options;
+    bool bundle = false;
+    bool codegen = false;
+    int32_t index = ParseOptions(argc, argv, options, bundle, codegen);
+    if (index == FAILED) {
+        cout << "usage: './transform [--nibble-rules] [--radix-edges] [--corpus words.txt] [--stats] "
+                "[--aho-corasick | --compress] hyph-en-us.tex ./out/' or "
+                "'./transform [--nibble-rules] [--radix-edges] --bundle ./out/hyphen.hpb hyph-en-us.tex "
+                "[hyph-de-1996.tex...]' or "
+                "'./transform --emit-cpp ./gen/ hyph-en-us.tex [hyph-de-1996.tex...]'"
+             << endl;
         return FAILED;
     }
+    if (codegen) {
+        OHOS::Hyphenate::HyphenProcessor hyphenProcessor(options);
+        return hyphenProcessor.ProcessCodegen(std::vector<std::string>(argv + index + 1, argv + argc), argv[index]);
+    }
+    if (bundle) {
+        OHOS::Hyphenate::HyphenProcessor hyphenProcessor(options);
+        return hyphenProcessor.ProcessBundle(std::vector<std::string>(argv + index + 1, argv + argc), argv[index]);
+    }
 
     // open output
-    string filePath = argv[1];
-    string outFilePath = argv[2];
+    string filePath = argv[index];
+    string outFilePath = argv[index + 1];
 
-    OHOS::Hyphenate::HyphenProcessor hyphenProcessor;
-    hyphenProcessor.Proccess(filePath, outFilePath);
-
-    return SUCCEED;
+    OHOS::Hyphenate::HyphenProcessor hyphenProcessor(options);
+    return hyphenProcessor.Proccess(filePath, outFilePath);
 }
+#endif
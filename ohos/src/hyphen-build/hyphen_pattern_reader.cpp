@@ -14,22 +14,39 @@
  */
 #include "hyphen_pattern.h"
 
+#include <array>
 #include <codecvt>
+#include <cstddef>
 #include <cstdio>
 #include <cerrno>
+#include <cstring>
+#include <climits>
 #include <fcntl.h>
 #include <fstream>
 #include <iostream>
+#include <algorithm>
 #include <map>
+#include <mutex>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <linux/mempolicy.h>
+#include <sched.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <unicode/utf.h>
 #include <unicode/utf8.h>
 #include <unistd.h>
+#include <utility>
+#include <zlib.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 using namespace std;
 
@@ -62,6 +79,93 @@ struct ArrayOf16bits {
     uint16_t codes[3]; // dynamic
 };
 
+// Longest rule that can be addressed: 4 bit word count, each 32 bit word holding
+// eight nibble packed levels
+constexpr size_t MAX_RULE_LEVELS = 0xf * NIBBLE_PADDING_SIZE;
+constexpr size_t SIMD_WIDTH = 16;
+
+// Expand nibble packed levels (low nibble first) to one level per byte,
+// 'levels' has room for MAX_RULE_LEVELS + SIMD_WIDTH bytes
+static void UnpackNibbles(const uint8_t* packed, size_t count, uint8_t* levels)
+{
+    constexpr size_t PACKED_WIDTH = SIMD_WIDTH / 2;
+    uint8_t input[MAX_RULE_LEVELS / 2 + PACKED_WIDTH] = {0};
+    memcpy(input, packed, count / 2);
+    for (size_t i = 0; i < count; i += SIMD_WIDTH) {
+#if defined(__SSE2__)
+        const __m128i mask = _mm_set1_epi8(0x0f);
+        __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(input + i / 2));
+        __m128i low = _mm_and_si128(bytes, mask);
+        __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 0x4), mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(levels + i), _mm_unpacklo_epi8(low, high));
+#elif defined(__ARM_NEON)
+        uint8x8_t bytes = vld1_u8(input + i / 2);
+        uint8x8x2_t zipped = vzip_u8(vand_u8(bytes, vdup_n_u8(0x0f)), vshr_n_u8(bytes, 0x4));
+        vst1q_u8(levels + i, vcombine_u8(zipped.val[0], zipped.val[1]));
+#else
+        for (size_t j = 0; j < PACKED_WIDTH; j++) {
+            levels[i + j * 2] = input[i / 2 + j] & 0x0f;
+            levels[i + j * 2 + 1] = input[i / 2 + j] >> 0x4;
+        }
+#endif
+    }
+}
+
+// Byte wise maximum of the rule levels into the result, bounded by the result size
+static void MergeLevels(uint8_t* result, size_t size, const uint8_t* levels, size_t count)
+{
+    size_t length = min(size, count);
+    size_t i = 0;
+    for (; i + SIMD_WIDTH <= length; i += SIMD_WIDTH) {
+#if defined(__SSE2__)
+        __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(result + i));
+        __m128i rule = _mm_loadu_si128(reinterpret_cast<const __m128i*>(levels + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(result + i), _mm_max_epu8(current, rule));
+#elif defined(__ARM_NEON)
+        vst1q_u8(result + i, vmaxq_u8(vld1q_u8(result + i), vld1q_u8(levels + i)));
+#else
+        for (size_t j = i; j < i + SIMD_WIDTH; j++) {
+            result[j] = std::max(result[j], levels[j]);
+        }
+#endif
+    }
+    for (; i < length; i++) {
+        result[i] = std::max(result[i], levels[i]);
+    }
+}
+
+// Bit i set when levels[i] is odd, for up to 64 levels
+static uint64_t OddLevelBits(const uint8_t* levels, size_t count)
+{
+    uint64_t bits = 0;
+    size_t i = 0;
+    for (; i + SIMD_WIDTH <= count; i += SIMD_WIDTH) {
+#if defined(__SSE2__)
+        // move the lowest bit of every byte to its sign bit
+        __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(levels + i));
+        uint64_t odd = static_cast<uint16_t>(_mm_movemask_epi8(_mm_slli_epi16(current, 0x7)));
+#elif defined(__ARM_NEON)
+        // weight the lowest bits by their position in each half and add them up pairwise
+        static const int8_t shifts[SIMD_WIDTH] = {0, 1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7};
+        uint8x16_t weighted = vshlq_u8(vandq_u8(vld1q_u8(levels + i), vdupq_n_u8(1)), vld1q_s8(shifts));
+        uint8x8_t sums = vpadd_u8(vget_low_u8(weighted), vget_high_u8(weighted));
+        sums = vpadd_u8(sums, sums);
+        sums = vpadd_u8(sums, sums);
+        uint64_t odd = vget_lane_u8(sums, 0) | (static_cast<uint64_t>(vget_lane_u8(sums, 1)) << 0x8);
+#else
+        uint64_t odd = 0;
+        for (size_t j = 0; j < SIMD_WIDTH; j++) {
+            odd |= static_cast<uint64_t>(levels[i + j] & 1) << j;
+        }
+#endif
+        bits |= odd << i;
+    }
+    for (; i < count; i++) {
+        bits |= static_cast<uint64_t>(levels[i] & 1) << i;
+    }
+    return bits;
+}
+
 struct Header {
     uint8_t magic1;
     uint8_t magic2;
@@ -96,17 +200,21 @@ struct Header {
         }
     }
 
-    inline static void ToLower(uint16_t& code)
+    inline static uint16_t MapCode(uint16_t code)
     {
         if (code == '.') {
-            code = '`';
+            return '`';
         } else if (code == '\'') {
-            code = '^';
+            return '^';
         } else if (code == '-') {
-            code = '_';
-        } else {
-            code = tolower(code);
+            return '_';
         }
+        return tolower(code);
+    }
+
+    inline static void ToLower(uint16_t& code)
+    {
+        code = MapCode(code);
         cout << "tolower: " << hex << static_cast<int>(code) << endl;
     }
 
@@ -115,17 +223,121 @@ struct Header {
         // need to write this in binary provider !!
         return (maxCp - minCp) * HYPHEN_BASE_CODE_SHIFT + maps->count;
     }
+
+    inline bool HasFlag(uint8_t flag) const
+    {
+        return (((version >> SHIFT_BITS_FLAGS) & 0xff) & flag) != 0;
+    }
 };
 
+// Expands the subtrees of a compressed container (HzHeader) into an anonymous
+// mapping laid out like the original file, so the rest of the reader works
+// unchanged. Pages of subtrees that are never touched are never populated.
+struct CompressedSubtrees {
+    ~CompressedSubtrees()
+    {
+        if (fShadow) {
+            (void)munmap(fShadow, fShadowSize);
+        }
+        (void)munmap(fContainer, fContainerSize);
+    }
+
+    static bool IsCompressed(const uint8_t* address, size_t size)
+    {
+        return size >= sizeof(HzHeader) && address[0] == HYPHEN_MAGIC && address[1] == HYPHEN_MAGIC_COMPRESSED;
+    }
+
+    int32_t Open(uint8_t* container, size_t containerSize)
+    {
+        fContainer = container;
+        fContainerSize = containerSize;
+        fHeader = reinterpret_cast<const HzHeader*>(container);
+        size_t tailSize = fHeader->originalSize - fHeader->tailOffset;
+        // the tail is stored after the prefix, which is padded to the rule alignment
+        size_t tailStart = sizeof(HzHeader) + ((fHeader->prefixSize + PADDING_SIZE - 1) & ~(PADDING_SIZE - 1));
+        if (fHeader->prefixSize > fHeader->tailOffset || fHeader->tailOffset > fHeader->originalSize ||
+            tailStart + tailSize > containerSize ||
+            fHeader->chunks + static_cast<size_t>(fHeader->chunkCount) * sizeof(HzChunk) > containerSize) {
+            cerr << "FATAL: malformed compressed container" << endl;
+            return FAILED;
+        }
+        fChunks = reinterpret_cast<const HzChunk*>(container + fHeader->chunks);
+        void* shadow = mmap(nullptr, fHeader->originalSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (shadow == MAP_FAILED) {
+            cerr << "FATAL: mmap shadow" << endl;
+            return FAILED;
+        }
+        fShadow = static_cast<uint8_t*>(shadow);
+        fShadowSize = fHeader->originalSize;
+        memcpy(fShadow, container + sizeof(HzHeader), fHeader->prefixSize);
+        memcpy(fShadow + fHeader->tailOffset, container + tailStart, tailSize);
+        fReady = make_unique<atomic<bool>[]>(fHeader->chunkCount);
+        return SUCCEED;
+    }
+
+    // Inflate the subtree of a toc entry on its first use
+    bool Expand(uint32_t entry)
+    {
+        if (entry >= fHeader->chunkCount || fReady[entry].load(memory_order_acquire)) {
+            return true;
+        }
+        lock_guard<mutex> lock(fLock);
+        if (fReady[entry].load(memory_order_relaxed)) {
+            return true;
+        }
+        const HzChunk& chunk = fChunks[entry];
+        if (chunk.size != 0) {
+            uLongf size = chunk.size;
+            if (chunk.offset + static_cast<size_t>(chunk.size) > fShadowSize ||
+                chunk.compressed + static_cast<size_t>(chunk.compressedSize) > fContainerSize ||
+                uncompress(fShadow + chunk.offset, &size, fContainer + chunk.compressed, chunk.compressedSize) !=
+                    Z_OK || size != chunk.size) {
+                cerr << "failed to inflate subtree " << entry << endl;
+                return false;
+            }
+        }
+        fReady[entry].store(true, memory_order_release);
+        return true;
+    }
+
+    uint8_t* fContainer{nullptr};
+    size_t fContainerSize{0};
+    const HzHeader* fHeader{nullptr};
+    const HzChunk* fChunks{nullptr};
+    uint8_t* fShadow{nullptr};
+    size_t fShadowSize{0};
+    unique_ptr<atomic<bool>[]> fReady;
+    mutex fLock;
+};
+
+struct CodeInfo;
+class MaskWindow;
+// Pattern lookup of a batch of words, instantiated per dictionary layout, see SelectKernel
+using LookupKernel = void (*)(const CodeInfo& dict, const std::vector<uint16_t>* targets,
+                              std::vector<uint8_t>* results, size_t count);
+// Same lookup reducing every word to its break mask as soon as it is done
+using MaskKernel = void (*)(const CodeInfo& dict, const std::vector<uint16_t>* targets, size_t count,
+                            MaskWindow& window);
+struct LookupKernels {
+    LookupKernel levels;
+    MaskKernel masks;
+};
+static LookupKernels SelectKernel(const CodeInfo& dict);
+
 struct CodeInfo {
-    int32_t OpenPatFile(const char* filePath);
+    int32_t OpenPatFile(const char* filePath, int32_t mapFlags = 0);
     int32_t GetHeader();
     int32_t GetCodeInfo(uint16_t code);
     void ProcessPattern(const size_t& offset, vector<uint8_t>& result, bool direct);
     bool ProcessDirect(const std::vector<uint16_t>& target, const size_t& offset);
-    void ProcessLinear(const std::vector<uint16_t>& target, const size_t& offset, vector<uint8_t>& result);
+    bool ProcessLinear(const std::vector<uint16_t>& target, const size_t& offset, vector<uint8_t>& result);
     bool ProcessNextCode(const std::vector<uint16_t>& target, const size_t& offset);
     void ClearResource();
+    // make sure the subtree of a toc offset is available, only compressed containers need work
+    bool ExpandSubtree(uint16_t tocOffset) const
+    {
+        return !fSubtrees || fSubtrees->Expand((tocOffset - 1) / HYPHEN_BASE_CODE_SHIFT);
+    }
     Header* fHeader{nullptr};
     uint8_t* fAddress{nullptr};
     FILE* fFile{nullptr};
@@ -138,11 +350,19 @@ struct CodeInfo {
     uint32_t fNextOffset;
     uint16_t* fStaticOffset{nullptr};
     ArrayOf16bits* fMappings{nullptr};
+    const uint8_t* fRules{nullptr};
+    const HyphenCodeFilter* fFilter{nullptr};
+    LookupKernel fKernel{nullptr};
+    MaskKernel fMaskKernel{nullptr};
+    bool fVerbose{true};
+    unique_ptr<CompressedSubtrees> fSubtrees;
 };
 
-int32_t CodeInfo::OpenPatFile(const char* filePath)
+int32_t CodeInfo::OpenPatFile(const char* filePath, int32_t mapFlags)
 {
-    cout << "Attempt to mmap " << filePath << endl;
+    if (fVerbose) {
+        cout << "Attempt to mmap " << filePath << endl;
+    }
 
     FILE* file = fopen(filePath, "r");
     if (file == nullptr) {
@@ -157,33 +377,73 @@ int32_t CodeInfo::OpenPatFile(const char* filePath)
         return FAILED;
     }
     size_t length = st.st_size;
-    uint8_t* address = static_cast<uint8_t*>(mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fileno(file), 0u));
+    uint8_t* address =
+        static_cast<uint8_t*>(mmap(nullptr, length, PROT_READ, MAP_PRIVATE | mapFlags, fileno(file), 0u));
     if (address == MAP_FAILED) {
         cerr << "FATAL: mmap" << endl;
         fclose(file);
         return FAILED;
     }
 
-    cout << "Magic: " << hex << *reinterpret_cast<uint32_t*>(address) << dec << endl;
+    if (fVerbose) {
+        cout << "Magic: " << hex << *reinterpret_cast<uint32_t*>(address) << dec << endl;
+    }
+    if (CompressedSubtrees::IsCompressed(address, length)) {
+        fSubtrees = make_unique<CompressedSubtrees>();
+        if (fSubtrees->Open(address, length) != SUCCEED) {
+            fSubtrees.reset();
+            fclose(file);
+            return FAILED;
+        }
+        address = fSubtrees->fShadow;
+        length = fSubtrees->fShadowSize;
+    }
     this->fFile = file;
     this->fFileSize = length;
     this->fAddress = address;
     return SUCCEED;
 }
 
-static std::vector<uint16_t> GetInputWord(const char* input)
+std::vector<uint16_t> GetInputWord(const char* input, bool verbose)
 {
     const std::string utf8Str = "." + std::string(input) + ".";
     std::vector<uint16_t> target = ConvertToUtf16(utf8Str);
     for (auto& code : target) {
-        Header::ToLower(code);
+        if (verbose) {
+            Header::ToLower(code);
+        } else {
+            code = Header::MapCode(code);
+        }
     }
     return target;
 }
 
+std::vector<uint16_t> GetInputWord(const uint16_t* utf16Word, size_t length)
+{
+    std::vector<uint16_t> target;
+    GetInputWord(utf16Word, length, target);
+    return target;
+}
+
+void GetInputWord(const uint16_t* utf16Word, size_t length, std::vector<uint16_t>& target)
+{
+    target.resize(length + HYPHEN_BASE_CODE_SHIFT);
+    target.front() = Header::MapCode('.');
+    for (size_t i = 0; i < length; i++) {
+        target[i + 1] = Header::MapCode(utf16Word[i]);
+    }
+    target.back() = Header::MapCode('.');
+}
+
 int32_t CodeInfo::GetHeader()
 {
-    fHeader = reinterpret_cast<Header*>(fAddress);
+    // bundled languages come with their header and rule table
+    if (fHeader == nullptr) {
+        fHeader = reinterpret_cast<Header*>(fAddress);
+    }
+    if (fRules == nullptr) {
+        fRules = fAddress;
+    }
     uint16_t minCp = fHeader->minCp;
     uint16_t maxCp = fHeader->maxCp;
     // get master table, it always is in direct mode
@@ -191,18 +451,42 @@ int32_t CodeInfo::GetHeader()
     // this is actually beyond the real 32 bit address, but just to have an offset that
     // is clearly out of bounds without recalculating it again
     fMaxCount = fHeader->MaxCount(fMappings);
-    cout << "min/max: " << minCp << "/" << maxCp << " count " << static_cast<int>(fMaxCount) << endl;
-    cout << "size of top level mappings: " << static_cast<int>(fMappings->count) << endl;
+    if (fHeader->HasFlag(HYPHEN_FLAG_CODE_FILTER)) {
+        // 4 byte aligned after the count and codes of the mappings
+        size_t position = (fHeader->mappings + sizeof(uint16_t) * (fMappings->count + 1) + PADDING_SIZE - 1) &
+            ~(PADDING_SIZE - 1);
+        auto filter = reinterpret_cast<const HyphenCodeFilter*>(fAddress + position);
+        constexpr size_t filterHeader = offsetof(HyphenCodeFilter, bitmaps);
+        if (position + filterHeader <= fFileSize &&
+            position + filterHeader + filter->words * HYPHEN_BASE_CODE_SHIFT * sizeof(uint32_t) <= fFileSize) {
+            fFilter = filter;
+        }
+    }
+    if (fVerbose) {
+        cout << "min/max: " << minCp << "/" << maxCp << " count " << static_cast<int>(fMaxCount) << endl;
+        cout << "size of top level mappings: " << static_cast<int>(fMappings->count) << endl;
+    }
     if (minCp == maxCp && fMappings->count == 0) {
         cerr << "### unexpected min/max in input file-> exit" << endl;
         return FAILED;
     }
+    LookupKernels kernels = SelectKernel(*this);
+    fKernel = kernels.levels;
+    fMaskKernel = kernels.masks;
     return SUCCEED;
 }
 
 void CodeInfo::ClearResource()
 {
-    (void)munmap(fAddress, fFileSize);
+    if (fFile == nullptr) { // part of a bundle, the mapping belongs to the bundle
+        fAddress = nullptr;
+        return;
+    }
+    if (fSubtrees) {
+        fSubtrees.reset();
+    } else {
+        (void)munmap(fAddress, fFileSize);
+    }
     fAddress = nullptr;
     (void)fclose(fFile);
     fFile = nullptr;
@@ -219,6 +503,9 @@ int32_t CodeInfo::GetCodeInfo(uint16_t code)
         cout << hex << char(code) << " unable to map, contiue straight" << endl;
         return FAILED;
     }
+    if (!ExpandSubtree(fOffset)) {
+        return FAILED;
+    }
 
     // previous entry end
     uint32_t baseOffset =
@@ -260,16 +547,25 @@ void CodeInfo::ProcessPattern(const size_t& offset, vector<uint8_t>& result, boo
     poffset = 0xfff & poffset;
 
     //   if we have reached pattern, apply it to result
-    auto p = reinterpret_cast<const Pattern*>(fAddress + poffset);
+    auto p = reinterpret_cast<const Pattern*>(fRules + poffset);
     if (count != 0) {
+        size_t start = offset - fIndex;
+        if (start >= result.size()) {
+            return;
+        }
+        const uint8_t* levels = p->patterns;
+        uint8_t unpacked[MAX_RULE_LEVELS + SIMD_WIDTH];
+        if (fHeader->HasFlag(HYPHEN_FLAG_NIBBLE_RULES)) {
+            count *= HYPHEN_BASE_CODE_SHIFT; // two levels per byte
+            UnpackNibbles(p->patterns, count, unpacked);
+            levels = unpacked;
+        }
         cout << "Node with a pattern, count " << count << hex << " offset: " << poffset << endl;
-        size_t i = 0;
-        for (size_t j = offset - fIndex; j < result.size() && i < count; j++) {
-            cout << "    " << static_cast<int>(j) << ": pattern index: " << i << " value: 0x" << hex
-                 << static_cast<int>(p->patterns[i]) << endl;
-            result[j] = std::max(result[j], (p->patterns[i]));
-            i++;
+        for (size_t i = 0; i < count && start + i < result.size(); i++) {
+            cout << "    " << static_cast<int>(start + i) << ": pattern index: " << i << " value: 0x" << hex
+                 << static_cast<int>(levels[i]) << endl;
         }
+        MergeLevels(result.data() + start, result.size() - start, levels, count);
     }
 }
 
@@ -296,36 +592,46 @@ bool CodeInfo::ProcessDirect(const std::vector<uint16_t>& target, const size_t&
     return false;
 }
 
-void CodeInfo::ProcessLinear(const std::vector<uint16_t>& target, const size_t& offset, vector<uint8_t>& result)
+bool CodeInfo::ProcessLinear(const std::vector<uint16_t>& target, const size_t& offset, vector<uint8_t>& result)
 {
     auto p = reinterpret_cast<const ArrayOf16bits*>(fStaticOffset + fNextOffset);
-    auto count = p->count;
+    uint16_t count = p->count & ~LINEAR_CONTINUATION;
 
     fIndex++;
     cout << "# linear " << offset << " " << fIndex << endl;
     if (fIndex > offset || count > (offset - fIndex + 1)) {
         // the pattern is longer than the remaining word
         cout << "# break loop on linear " << offset << " " << fIndex << endl;
-        return;
+        return true;
     }
     // check the rest of the string
     for (auto j = 0; j < count; j++) {
         cout << "    linear " << offset << " index: " << j << " value: " << hex << static_cast<int>(p->codes[j]) <<
             " vs " << static_cast<int>(target[offset - fIndex]) << endl;
         if (p->codes[j] != target[offset - fIndex]) {
-            return;
+            return true;
         } else {
             fIndex++;
         }
     }
-    // if we reach the end, apply pattern
     fNextOffset += count + 1; // array items + one for the count
     fIndex--;                 // because of recursion
+    if ((p->count & LINEAR_CONTINUATION) != 0) {
+        // the chain ends in a branching node, continue from there
+        auto nextValue = *(fStaticOffset + fNextOffset);
+        fCode = target[offset - fIndex];
+        fNextOffset = nextValue & 0x3fff;
+        fType = static_cast<PathType>(nextValue >> SHIFT_BITS_14);
+        cout << "  continue linear: " << hex << nextValue << " with offset: " << fNextOffset << endl;
+        return false;
+    }
+    // if we reach the end, apply pattern
     ProcessPattern(offset, result, false);
     if (*(fStaticOffset + fNextOffset) != 0 && offset > count) { // peek if there is more to come
         // make it tail recursive to save stack
         return ProcessLinear(target, offset, result);
     }
+    return true;
 }
 
 bool CodeInfo::ProcessNextCode(const std::vector<uint16_t>& target, const size_t& offset)
@@ -336,12 +642,13 @@ bool CodeInfo::ProcessNextCode(const std::vector<uint16_t>& target, const size_t
         return true;
     }
     auto p = reinterpret_cast<const ArrayOf16bits*>(fStaticOffset + fNextOffset);
-    uint16_t count = p->count;
+    uint16_t count = p->count & ~PAIRS_FREQUENCY_ORDER;
+    bool sorted = (p->count & PAIRS_FREQUENCY_ORDER) == 0;
     fIndex++;
     cout << "  continue to value pairs with size: " << count << " and code '" <<
         static_cast<int>(target[offset - fIndex]) << "'" << endl;
 
-    //     check pairs, array is sorted (but small)
+    //     check pairs, array is sorted by code or by access frequency (but small)
     bool match = false;
     for (size_t j = 0; j < count; j += HYPHEN_BASE_CODE_SHIFT) {
         cout << "    checking pair: " << j << " value: " << hex << static_cast<int>(p->codes[j]) << " vs " <<
@@ -359,7 +666,7 @@ bool CodeInfo::ProcessNextCode(const std::vector<uint16_t>& target, const size_t
             fType = static_cast<PathType>(p->codes[j + 1] >> SHIFT_BITS_14);
             match = true;
             break;
-        } else if (p->codes[j] > target[offset - fIndex]) {
+        } else if (sorted && p->codes[j] > target[offset - fIndex]) {
             break;
         }
     }
@@ -370,29 +677,588 @@ bool CodeInfo::ProcessNextCode(const std::vector<uint16_t>& target, const size_t
     return false;
 }
 
-void PrintResult(const vector<uint8_t>& result, const vector<uint16_t>& target)
+// Single pass matcher over the Aho-Corasick variant of the binary
+struct AcMatcher {
+    explicit AcMatcher(const uint8_t* address)
+        : fHeader(reinterpret_cast<const AcHeader*>(address)),
+          fStates(reinterpret_cast<const AcState*>(address + fHeader->states)),
+          fCodes(reinterpret_cast<const uint16_t*>(address + fHeader->edgeCodes)),
+          fTargets(reinterpret_cast<const uint32_t*>(address + fHeader->edgeTargets)),
+          fRules(address + fHeader->rules)
+    {
+    }
+
+    uint32_t Next(uint32_t state, uint16_t code) const
+    {
+        while (true) {
+            const AcState& current = fStates[state];
+            const uint16_t* begin = fCodes + current.edges;
+            const uint16_t* end = begin + current.edgeCount;
+            const uint16_t* ite = lower_bound(begin, end, code);
+            if (ite != end && *ite == code) {
+                return fTargets[ite - fCodes];
+            }
+            if (state == 0) {
+                return 0;
+            }
+            state = current.fail;
+        }
+    }
+
+    void ApplyRule(const AcState& state, size_t end, uint8_t* result, size_t size) const
+    {
+        size_t start = end + 1 - state.depth;
+        const uint8_t* levels = fRules + state.rule;
+        size_t count = state.ruleCount;
+        uint8_t unpacked[MAX_RULE_LEVELS + SIMD_WIDTH];
+        if ((fHeader->flags & HYPHEN_FLAG_NIBBLE_RULES) != 0) {
+            count = min(count, MAX_RULE_LEVELS);
+            UnpackNibbles(levels, count, unpacked);
+            levels = unpacked;
+        }
+        MergeLevels(result + start, size - start, levels, count);
+    }
+
+    // result holds a level per code of the target
+    void Process(const std::vector<uint16_t>& target, uint8_t* result) const
+    {
+        uint32_t state = 0;
+        for (size_t i = 0; i < target.size(); i++) {
+            state = Next(state, target[i]);
+            uint32_t output = fStates[state].ruleCount != 0 ? state : fStates[state].outputLink;
+            while (output != 0) {
+                ApplyRule(fStates[output], i, result, target.size());
+                output = fStates[output].outputLink;
+            }
+        }
+    }
+
+    const AcHeader* fHeader;
+    const AcState* fStates;
+    const uint16_t* fCodes;
+    const uint32_t* fTargets;
+    const uint8_t* fRules;
+};
+
+// True if the word has any code of the alphabet. Codes outside the range of the bitmap are
+// sorted out eight at a time, only the ones within it look up their bit.
+static bool HasAlphabetCode(const HyphenCodeFilter& filter, const std::vector<uint16_t>& word)
 {
-    cout << dec << "result size: " << result.size() << " while expecting " << target.size() << endl;
-    if (result.size() <= target.size() + 1) {
-        size_t i = 0;
-        for (auto bp : result) {
-            cout << hex << static_cast<int>(target[i++]) << ": " << to_string(bp) << endl;
+    const uint16_t* codes = word.data();
+    const size_t count = word.size();
+    size_t i = 0;
+#if defined(__SSE2__) || defined(__ARM_NEON)
+    constexpr size_t lanes = SIMD_WIDTH / sizeof(uint16_t);
+    // words is at most MAX_CODE_FILTER_WORDS, the span fits 16 bits
+    const uint16_t span = static_cast<uint16_t>((filter.words << HyphenCodeFilter::WORD_SHIFT) - 1);
+    for (; i + lanes <= count; i += lanes) {
+#if defined(__SSE2__)
+        // code - first is within the range where the saturated subtraction of the span is zero
+        __m128i offsets = _mm_sub_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + i)),
+                                        _mm_set1_epi16(static_cast<int16_t>(filter.first)));
+        __m128i inRange = _mm_cmpeq_epi16(_mm_subs_epu16(offsets, _mm_set1_epi16(static_cast<int16_t>(span))),
+                                          _mm_setzero_si128());
+        bool any = _mm_movemask_epi8(inRange) != 0;
+#else
+        uint16x8_t inRange = vcleq_u16(vsubq_u16(vld1q_u16(codes + i), vdupq_n_u16(filter.first)),
+                                       vdupq_n_u16(span));
+        uint64x2_t halves = vreinterpretq_u64_u16(inRange);
+        bool any = (vgetq_lane_u64(halves, 0) | vgetq_lane_u64(halves, 1)) != 0;
+#endif
+        if (!any) {
+            continue;
+        }
+        for (size_t j = i; j < i + lanes; j++) {
+            if (filter.InAlphabet(codes[j])) {
+                return true;
+            }
         }
     }
+#endif
+    for (; i < count; i++) {
+        if (filter.InAlphabet(codes[i])) {
+            return true;
+        }
+    }
+    return false;
 }
 
-bool InitializeCodeInfo(OHOS::Hyphenate::CodeInfo& codeInfo, const char* filePath)
+// True if the codes of a linear segment match the word read backwards from position, which is
+// at least count - 1. Eight codes are compared at once, with the word block reversed, as long
+// as both the word and the binary (up to limit) hold a full block.
+static bool MatchSegment(const uint16_t* codes, size_t count, const uint16_t* word, size_t position,
+                         const uint8_t* limit)
 {
-    if (codeInfo.OpenPatFile(filePath) != SUCCEED) {
-        return false;
+    size_t j = 0;
+#if defined(__SSE2__) || defined(__ARM_NEON)
+    constexpr size_t lanes = SIMD_WIDTH / sizeof(uint16_t);
+    for (; j < count && position >= j + lanes - 1 &&
+           reinterpret_cast<const uint8_t*>(codes + j + lanes) <= limit; j += lanes) {
+        size_t valid = min(lanes, count - j);
+        const uint16_t* block = word + position - j - (lanes - 1);
+#if defined(__SSE2__)
+        __m128i text = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+        text = _mm_shuffle_epi32(text, _MM_SHUFFLE(1, 0, 3, 2));
+        text = _mm_shufflehi_epi16(_mm_shufflelo_epi16(text, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3));
+        __m128i chain = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + j));
+        uint32_t equal = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi16(chain, text)));
+        uint32_t needed = (1u << (valid * sizeof(uint16_t))) - 1;
+        if ((equal & needed) != needed) {
+            return false;
+        }
+#else
+        static const uint16_t laneIndex[lanes] = {0, 1, 2, 3, 4, 5, 6, 7};
+        uint16x8_t text = vrev64q_u16(vld1q_u16(block));
+        text = vextq_u16(text, text, lanes / 2);
+        uint16x8_t equal = vceqq_u16(vld1q_u16(codes + j), text);
+        uint16x8_t differ = vbicq_u16(vcltq_u16(vld1q_u16(laneIndex), vdupq_n_u16(valid)), equal);
+        uint64x2_t halves = vreinterpretq_u64_u16(differ);
+        if ((vgetq_lane_u64(halves, 0) | vgetq_lane_u64(halves, 1)) != 0) {
+            return false;
+        }
+#endif
     }
-    if (codeInfo.GetHeader() != SUCCEED) {
-        codeInfo.ClearResource();
+#endif
+    for (; j < count; j++) {
+        if (codes[j] != word[position - j]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Lookup of the patterns ending at one position of a word, advanced one node at a
+// time so that the walks of several positions can be interleaved. Mirrors the
+// CodeInfo traversal without the trace output.
+struct TrieCursor {
+    const std::vector<uint16_t>* target{nullptr};
+    uint8_t* levels{nullptr}; // one per code of the target
+    size_t word{0};
+    const uint16_t* staticOffset{nullptr};
+    size_t end{0};
+    uint32_t index{0};
+    uint32_t nextOffset{0};
+    PathType type{PathType::PATTERN};
+};
+
+static const uint16_t* CursorNode(const CodeInfo& dict, const TrieCursor& cursor)
+{
+    if (cursor.type == PathType::PATTERN && (dict.fHeader->version >> 0x18) >= 0x2) {
+        return reinterpret_cast<const uint16_t*>(dict.fAddress) + cursor.nextOffset + (dict.fHeader->version & 0xffff);
+    }
+    return cursor.staticOffset + cursor.nextOffset;
+}
+
+// What the lookup needs to know about a dictionary layout. None of it changes once the
+// dictionary is open, so the cursor walk is instantiated per combination and picked by
+// SelectKernel instead of testing the header on every node.
+template <bool COMMON_BASE, bool MAPPINGS, bool SINGLE_CODE, bool NIBBLES>
+struct KernelTraits {
+    // version 2 and later: PATTERN nodes are relative to the common node base
+    static constexpr bool commonBase = COMMON_BASE;
+    // top level codes outside of minCp..maxCp are looked up in the mappings
+    static constexpr bool mappings = MAPPINGS;
+    // minCp == maxCp, the codes of direct tables are not range checked
+    static constexpr bool singleCode = SINGLE_CODE;
+    // rule levels are packed two per byte
+    static constexpr bool nibbles = NIBBLES;
+};
+
+template <typename K>
+static inline const uint16_t* KernelNode(const CodeInfo& dict, const TrieCursor& cursor)
+{
+    if constexpr (K::commonBase) {
+        if (cursor.type == PathType::PATTERN) {
+            return reinterpret_cast<const uint16_t*>(dict.fAddress) + cursor.nextOffset +
+                (dict.fHeader->version & 0xffff);
+        }
+    }
+    return cursor.staticOffset + cursor.nextOffset;
+}
+
+template <typename K>
+static inline uint16_t TopLevelOffset(const CodeInfo& dict, uint16_t code)
+{
+    if constexpr (!K::mappings) {
+        if (code < dict.fHeader->minCp || code > dict.fHeader->maxCp) {
+            return dict.fMaxCount;
+        }
+    }
+    return dict.fHeader->CodeOffset(code, dict.fMappings);
+}
+
+template <typename K>
+static bool StartCursor(const CodeInfo& dict, TrieCursor& cursor)
+{
+    uint16_t offset = TopLevelOffset<K>(dict, (*cursor.target)[cursor.end]);
+    if (offset == dict.fMaxCount || !dict.ExpandSubtree(offset)) {
         return false;
     }
+    const uint32_t* toc = reinterpret_cast<const uint32_t*>(dict.fAddress + dict.fHeader->toc);
+    uint32_t initialValue = toc[offset];
+    cursor.type = static_cast<PathType>(initialValue >> SHIFT_BITS_30);
+    cursor.staticOffset = reinterpret_cast<const uint16_t*>(dict.fAddress + HYPHEN_BASE_CODE_SHIFT * toc[offset - 1]);
+    cursor.nextOffset = initialValue & 0x3fffffff;
+    cursor.index = 0;
     return true;
 }
 
+template <typename K>
+static void ApplyCursorPattern(const CodeInfo& dict, TrieCursor& cursor)
+{
+    uint16_t poffset = *KernelNode<K>(dict, cursor);
+    cursor.nextOffset++;
+    if (!poffset) {
+        return;
+    }
+    size_t count = (poffset >> 0xc) * 0x4;
+    const uint8_t* levels = dict.fRules + (poffset & 0xfff);
+    uint8_t unpacked[MAX_RULE_LEVELS + SIMD_WIDTH];
+    if constexpr (K::nibbles) {
+        count *= HYPHEN_BASE_CODE_SHIFT;
+        UnpackNibbles(levels, count, unpacked);
+        levels = unpacked;
+    }
+    size_t start = cursor.end - cursor.index;
+    if (count != 0 && start < cursor.target->size()) {
+        MergeLevels(cursor.levels + start, cursor.target->size() - start, levels, count);
+    }
+}
+
+// Returns true when the chain continues into a branching node, see LINEAR_CONTINUATION
+template <typename K>
+static bool ProcessCursorLinear(const CodeInfo& dict, TrieCursor& cursor)
+{
+    const auto& target = *cursor.target;
+    const uint8_t* limit = dict.fAddress + dict.fFileSize;
+    while (true) {
+        auto p = reinterpret_cast<const ArrayOf16bits*>(cursor.staticOffset + cursor.nextOffset);
+        uint16_t count = p->count & ~LINEAR_CONTINUATION;
+        cursor.index++;
+        if (cursor.index > cursor.end || count > (cursor.end - cursor.index + 1)) {
+            return false;
+        }
+        if (!MatchSegment(p->codes, count, target.data(), cursor.end - cursor.index, limit)) {
+            return false;
+        }
+        cursor.index += count;
+        cursor.nextOffset += count + 1;
+        cursor.index--;
+        if ((p->count & LINEAR_CONTINUATION) != 0) {
+            uint16_t value = *(cursor.staticOffset + cursor.nextOffset);
+            cursor.nextOffset = value & 0x3fff;
+            cursor.type = static_cast<PathType>(value >> SHIFT_BITS_14);
+            return true;
+        }
+        ApplyCursorPattern<K>(dict, cursor);
+        if (*(cursor.staticOffset + cursor.nextOffset) == 0 || cursor.end <= count) {
+            return false;
+        }
+    }
+}
+
+// Resolve the node the cursor points to, returns false once the walk is over
+template <typename K>
+static bool StepCursor(const CodeInfo& dict, TrieCursor& cursor)
+{
+    ApplyCursorPattern<K>(dict, cursor);
+    const auto& target = *cursor.target;
+    if (cursor.type == PathType::DIRECT) {
+        if (cursor.index == cursor.end) {
+            return false;
+        }
+        cursor.index++;
+        uint16_t offset = dict.fHeader->CodeOffset(target[cursor.end - cursor.index]);
+        if constexpr (!K::singleCode) {
+            if (offset > dict.fHeader->maxCp) {
+                return false;
+            }
+        }
+        auto nextValue = *(cursor.staticOffset + cursor.nextOffset + offset);
+        cursor.nextOffset = nextValue & 0x3fff;
+        cursor.type = static_cast<PathType>(nextValue >> SHIFT_BITS_14);
+        return true;
+    } else if (cursor.type == PathType::PAIRS) {
+        if (cursor.index == cursor.end) {
+            return false;
+        }
+        auto p = reinterpret_cast<const ArrayOf16bits*>(cursor.staticOffset + cursor.nextOffset);
+        cursor.index++;
+        uint16_t code = target[cursor.end - cursor.index];
+        uint16_t count = p->count & ~PAIRS_FREQUENCY_ORDER;
+        bool sorted = (p->count & PAIRS_FREQUENCY_ORDER) == 0;
+        for (size_t j = 0; j < count; j += HYPHEN_BASE_CODE_SHIFT) {
+            if (p->codes[j] == code) {
+                cursor.nextOffset = p->codes[j + 1] & 0x3fff;
+                cursor.type = static_cast<PathType>(p->codes[j + 1] >> SHIFT_BITS_14);
+                return true;
+            } else if (sorted && p->codes[j] > code) {
+                break;
+            }
+        }
+        return false;
+    } else if (cursor.type == PathType::LINEAR) {
+        return ProcessCursorLinear<K>(dict, cursor);
+    }
+    return false;
+}
+
+// Amount of lookups kept in flight, enough to cover the latency of a cache miss
+constexpr size_t BATCH_CURSORS = 8;
+
+// Levels written to the result vectors of the caller
+class LevelVectors {
+public:
+    explicit LevelVectors(std::vector<uint8_t>* results) : fResults(results) {}
+
+    bool Begin(size_t word)
+    {
+        (void)word;
+        return true;
+    }
+    uint8_t* Levels(size_t word) const
+    {
+        return fResults[word].data();
+    }
+    void Acquire(size_t word)
+    {
+        (void)word;
+    }
+    void Release(size_t word)
+    {
+        (void)word;
+    }
+    void Done(size_t word)
+    {
+        (void)word;
+    }
+
+private:
+    std::vector<uint8_t>* fResults;
+};
+
+// Levels of the words in flight, kept in scratch slots and reduced to break masks in
+// word order once no cursor works on them anymore. The slots keep their storage, so a
+// thread reusing its window allocates nothing per word.
+class MaskWindow {
+public:
+    // power of two, words started ahead of the oldest unfinished one
+    static constexpr size_t SLOTS = 2 * BATCH_CURSORS;
+
+    void Reset(const std::vector<uint16_t>* targets, HyphenBreakMasks& masks, const HyphenBreakOptions& options)
+    {
+        fTargets = targets;
+        fMasks = &masks;
+        fOptions = options;
+        fFlushed = 0;
+        fStarted = 0;
+    }
+    // false while all slots hold unfinished words
+    bool Begin(size_t word)
+    {
+        if (word - fFlushed >= SLOTS) {
+            return false;
+        }
+        Slot& slot = fSlots[word & (SLOTS - 1)];
+        slot.levels.assign(fTargets[word].size(), 0);
+        slot.cursors = 0;
+        slot.done = false;
+        fStarted = word + 1;
+        return true;
+    }
+    uint8_t* Levels(size_t word)
+    {
+        return fSlots[word & (SLOTS - 1)].levels.data();
+    }
+    void Acquire(size_t word)
+    {
+        fSlots[word & (SLOTS - 1)].cursors++;
+    }
+    // only the oldest word can complete the words after it
+    void Release(size_t word)
+    {
+        if (--fSlots[word & (SLOTS - 1)].cursors == 0 && word == fFlushed) {
+            Flush();
+        }
+    }
+    // every position of the word was handed to a cursor
+    void Done(size_t word)
+    {
+        fSlots[word & (SLOTS - 1)].done = true;
+        if (word == fFlushed) {
+            Flush();
+        }
+    }
+    // single word, without cursors
+    std::vector<uint8_t>& Scratch(size_t size)
+    {
+        fSlots[0].levels.assign(size, 0);
+        return fSlots[0].levels;
+    }
+
+private:
+    struct Slot {
+        std::vector<uint8_t> levels;
+        size_t cursors{0};
+        bool done{false};
+    };
+
+    void Flush()
+    {
+        while (fFlushed < fStarted) {
+            const Slot& slot = fSlots[fFlushed & (SLOTS - 1)];
+            if (!slot.done || slot.cursors != 0) {
+                return;
+            }
+            fMasks->Append(slot.levels.data(), slot.levels.size(), fOptions);
+            fFlushed++;
+        }
+    }
+
+    Slot fSlots[SLOTS];
+    const std::vector<uint16_t>* fTargets{nullptr};
+    HyphenBreakMasks* fMasks{nullptr};
+    HyphenBreakOptions fOptions;
+    size_t fFlushed{0};
+    size_t fStarted{0};
+};
+
+// Walks the words with a group of cursors in lockstep: every round prefetches the
+// next node of each cursor before any of them is resolved, so the dependent loads
+// of different positions overlap instead of stalling one after another. The levels
+// go to the output, which is told when a word has no more work pending.
+template <typename K, typename O>
+static void ProcessBatch(const CodeInfo& dict, const std::vector<uint16_t>* targets, size_t count, O& output)
+{
+    // words the filter rules out are passed with no positions left
+    const HyphenCodeFilter* filter = dict.fFilter;
+    auto positions = [targets, filter](size_t word) {
+        return filter == nullptr || HasAlphabetCode(*filter, targets[word]) ? targets[word].size() : 0;
+    };
+    size_t word = 0;
+    size_t end = 0;
+    bool started = false;
+    // false once all words are handed out, or while the output has no room for the next one
+    auto refill = [&](TrieCursor& cursor) {
+        while (word < count) {
+            if (!started) {
+                if (!output.Begin(word)) {
+                    return false;
+                }
+                started = true;
+                end = positions(word);
+            }
+            if (end <= 1) { // position zero is never a pattern end
+                output.Done(word++);
+                started = false;
+                continue;
+            }
+            cursor.end = --end;
+            if (filter != nullptr && !filter->CanEnd(targets[word][end])) {
+                continue;
+            }
+            cursor.target = &targets[word];
+            cursor.levels = output.Levels(word);
+            cursor.word = word;
+            if (StartCursor<K>(dict, cursor)) {
+                output.Acquire(word);
+                __builtin_prefetch(KernelNode<K>(dict, cursor));
+                return true;
+            }
+        }
+        return false;
+    };
+
+    TrieCursor cursors[BATCH_CURSORS];
+    bool active[BATCH_CURSORS] = {false};
+    size_t activeCount = 0;
+    for (size_t i = 0; i < BATCH_CURSORS; i++) {
+        active[i] = refill(cursors[i]);
+        activeCount += active[i] ? 1 : 0;
+    }
+    while (activeCount != 0) {
+        for (size_t i = 0; i < BATCH_CURSORS; i++) {
+            if (!active[i]) {
+                continue;
+            }
+            if (StepCursor<K>(dict, cursors[i])) {
+                __builtin_prefetch(KernelNode<K>(dict, cursors[i]));
+            } else {
+                output.Release(cursors[i].word);
+                if (!(active[i] = refill(cursors[i]))) {
+                    activeCount--;
+                }
+            }
+        }
+        // cursors left idle while the output had no room take up work again
+        for (size_t i = 0; activeCount < BATCH_CURSORS && word < count && i < BATCH_CURSORS; i++) {
+            if (!active[i] && (active[i] = refill(cursors[i]))) {
+                activeCount++;
+            }
+        }
+    }
+}
+
+template <typename K>
+static void LookupLevels(const CodeInfo& dict, const std::vector<uint16_t>* targets, std::vector<uint8_t>* results,
+                         size_t count)
+{
+    LevelVectors output(results);
+    ProcessBatch<K>(dict, targets, count, output);
+}
+
+template <typename K>
+static void LookupMasks(const CodeInfo& dict, const std::vector<uint16_t>* targets, size_t count, MaskWindow& window)
+{
+    ProcessBatch<K>(dict, targets, count, window);
+}
+
+// One bit per KernelTraits parameter, in their order
+enum KernelBits : size_t {
+    KERNEL_COMMON_BASE = 0x1,
+    KERNEL_MAPPINGS = 0x2,
+    KERNEL_SINGLE_CODE = 0x4,
+    KERNEL_NIBBLES = 0x8,
+    KERNEL_VARIANTS = 0x10,
+};
+
+template <size_t BITS>
+static constexpr LookupKernels KernelFor()
+{
+    using K = KernelTraits<(BITS & KERNEL_COMMON_BASE) != 0, (BITS & KERNEL_MAPPINGS) != 0,
+                           (BITS & KERNEL_SINGLE_CODE) != 0, (BITS & KERNEL_NIBBLES) != 0>;
+    return {&LookupLevels<K>, &LookupMasks<K>};
+}
+
+template <size_t... BITS>
+static constexpr array<LookupKernels, sizeof...(BITS)> KernelTable(index_sequence<BITS...>)
+{
+    return {KernelFor<BITS>()...};
+}
+
+static constexpr auto KERNELS = KernelTable(make_index_sequence<KERNEL_VARIANTS>());
+
+static LookupKernels SelectKernel(const CodeInfo& dict)
+{
+    const Header& header = *dict.fHeader;
+    size_t bits = (header.version >> 0x18) >= 0x2 ? static_cast<size_t>(KERNEL_COMMON_BASE) : 0;
+    bits |= dict.fMappings->count != 0 ? static_cast<size_t>(KERNEL_MAPPINGS) : 0;
+    bits |= header.minCp == header.maxCp ? static_cast<size_t>(KERNEL_SINGLE_CODE) : 0;
+    bits |= header.HasFlag(HYPHEN_FLAG_NIBBLE_RULES) ? static_cast<size_t>(KERNEL_NIBBLES) : 0;
+    return KERNELS[bits];
+}
+
+void PrintResult(const vector<uint8_t>& result, const vector<uint16_t>& target)
+{
+    cout << dec << "result size: " << result.size() << " while expecting " << target.size() << endl;
+    if (result.size() <= target.size() + 1) {
+        size_t i = 0;
+        for (auto bp : result) {
+            cout << hex << static_cast<int>(target[i++]) << ": " << to_string(bp) << endl;
+        }
+    }
+}
+
 void ProcessCodeLoop(OHOS::Hyphenate::CodeInfo& codeInfo, const std::vector<uint16_t>& target, size_t i,
                      std::vector<uint8_t>& result)
 {
@@ -409,8 +1275,9 @@ void ProcessCodeLoop(OHOS::Hyphenate::CodeInfo& codeInfo, const std::vector<uint
                 continueLoop = false;
             }
         } else if (codeInfo.fType == OHOS::Hyphenate::PathType::LINEAR) {
-            codeInfo.ProcessLinear(target, i, result);
-            continueLoop = false;
+            if (codeInfo.ProcessLinear(target, i, result)) {
+                continueLoop = false;
+            }
         } else {
             if (codeInfo.ProcessNextCode(target, i)) {
                 continueLoop = false;
@@ -423,6 +1290,9 @@ void ProcessCodeInfo(OHOS::Hyphenate::CodeInfo& codeInfo, const std::vector<uint
                      std::vector<uint8_t>& result)
 {
     for (size_t i = target.size() - 1; i != 0; --i) {
+        if (codeInfo.fFilter && !codeInfo.fFilter->CanEnd(target[i])) {
+            continue;
+        }
         if (codeInfo.GetCodeInfo(target[i]) != SUCCEED) {
             continue;
         }
@@ -431,47 +1301,674 @@ void ProcessCodeInfo(OHOS::Hyphenate::CodeInfo& codeInfo, const std::vector<uint
     }
 }
 
+static bool IsAhoCorasick(const CodeInfo& codeInfo)
+{
+    return codeInfo.fFileSize >= sizeof(AcHeader) && codeInfo.fAddress[0] == HYPHEN_MAGIC &&
+        codeInfo.fAddress[1] == HYPHEN_MAGIC_AHO_CORASICK;
+}
+
 int32_t HyphenReader::Read(const char* filePath, const std::vector<uint16_t>& utf16Target) const
 {
     CodeInfo codeInfo;
-    if (!InitializeCodeInfo(codeInfo, filePath)) {
+    if (codeInfo.OpenPatFile(filePath) != SUCCEED) {
         return FAILED;
     }
 
     std::vector<uint8_t> result(utf16Target.size(), 0);
-    ProcessCodeInfo(codeInfo, utf16Target, result);
+    if (IsAhoCorasick(codeInfo)) {
+        cout << "Aho-Corasick automaton" << endl;
+        AcMatcher(codeInfo.fAddress).Process(utf16Target, result.data());
+    } else if (codeInfo.GetHeader() == SUCCEED) {
+        ProcessCodeInfo(codeInfo, utf16Target, result);
+    } else {
+        codeInfo.ClearResource();
+        return FAILED;
+    }
 
     codeInfo.ClearResource();
     PrintResult(result, utf16Target);
     return SUCCEED;
 }
-} // namespace OHOS::Hyphenate
 
-namespace {
-constexpr size_t ARG_NUM = 2;
+int32_t HyphenReader::ReadBatch(const char* filePath, const std::vector<std::vector<uint16_t>>& utf16Targets,
+                                std::vector<std::vector<uint8_t>>& results) const
+{
+    auto dictionary = HyphenDictionary::Open(filePath);
+    if (dictionary == nullptr) {
+        return FAILED;
+    }
+    return dictionary->HyphenateBatch(utf16Targets, results);
+}
+
+HyphenDictionary::HyphenDictionary() : fCodeInfo(make_unique<CodeInfo>())
+{
+    fCodeInfo->fVerbose = false;
+}
 
-std::vector<uint16_t> CheckArgs(int argc, char** argv)
+HyphenDictionary::~HyphenDictionary()
 {
-    std::vector<uint16_t> target;
-    if (argc != 3) { // 3: valid argument number
-        cout << "usage: './hyphen hyph-en-us.hpb <mytestword>' " << endl;
-        return target;
+    fStopWarmUp = true;
+    if (fWarmUp.joinable()) {
+        fWarmUp.join();
     }
-    target = OHOS::Hyphenate::GetInputWord(argv[ARG_NUM]);
-    if (target.empty()) {
-        cout << "usage: './hyphen hyph-en-us.hpb <mytestword>' " << endl;
+    for (auto& replica : fReplicas) {
+        if (replica) {
+            (void)munmap(replica->fAddress, replica->fFileSize);
+        }
+    }
+    if (fCodeInfo->fAddress) {
+        fCodeInfo->ClearResource();
+    }
+}
+
+// Lock the pages holding the header, and for the trie the toc and mappings at the end of the file
+void HyphenDictionary::LockMetadata()
+{
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const CodeInfo& codeInfo = *fCodeInfo;
+    if (mlock(codeInfo.fAddress, min(pageSize, codeInfo.fFileSize)) != 0) {
+        cerr << "mlock header failed: " << errno << endl;
+    }
+    if (fAhoCorasick || codeInfo.fHeader->toc >= codeInfo.fFileSize) {
+        return;
+    }
+    size_t start = codeInfo.fHeader->toc & ~(pageSize - 1);
+    if (mlock(codeInfo.fAddress + start, codeInfo.fFileSize - start) != 0) {
+        cerr << "mlock toc failed: " << errno << endl;
     }
-    return target;
 }
-} // namespace
 
-int main(int argc, char** argv)
+// Fault in the recorded hot ranges, runs on a background thread
+void HyphenDictionary::WarmUp(std::vector<HyphenPageRange> profile)
 {
-    std::vector<uint16_t> target = CheckArgs(argc, argv);
-    if (target.empty()) {
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const uint8_t* address = fCodeInfo->fAddress;
+    const size_t size = fCodeInfo->fFileSize;
+    for (const auto& range : profile) {
+        if (range.offset >= size) {
+            continue;
+        }
+        size_t start = range.offset & ~(pageSize - 1);
+        size_t end = min(size, range.offset + range.length);
+        (void)madvise(const_cast<uint8_t*>(address) + start, end - start, MADV_WILLNEED);
+        for (size_t offset = start; offset < end && !fStopWarmUp; offset += pageSize) {
+            fWarmUpSum += *static_cast<const volatile uint8_t*>(address + offset);
+        }
+    }
+    fWarmedUp = true;
+}
+
+const string NUMA_NODE_ROOT = "/sys/devices/system/node/";
+constexpr uint16_t NO_NUMA_NODE = 0xffff;
+
+static string ReadFirstLine(const string& path)
+{
+    ifstream input(path);
+    string line;
+    getline(input, line);
+    return line;
+}
+
+// sysfs node and cpu lists, e.g. "0-3,8-11"
+static vector<uint32_t> ParseIdList(const string& list)
+{
+    vector<uint32_t> ids;
+    const char* cursor = list.c_str();
+    while (*cursor != '\0') {
+        char* end = nullptr;
+        unsigned long first = strtoul(cursor, &end, 10);
+        if (end == cursor) {
+            break;
+        }
+        unsigned long last = first;
+        if (*end == '-') {
+            cursor = end + 1;
+            last = strtoul(cursor, &end, 10);
+        }
+        for (unsigned long id = first; id <= last && id < CPU_SETSIZE; id++) {
+            ids.push_back(static_cast<uint32_t>(id));
+        }
+        cursor = *end == ',' ? end + 1 : "";
+    }
+    return ids;
+}
+
+// Copy the dictionary into anonymous memory bound to node. The copy runs on a cpu of the
+// node, so first touch still places the pages when mbind is not permitted.
+static unique_ptr<CodeInfo> CopyToNode(const CodeInfo& source, bool ahoCorasick, uint32_t node,
+                                       const vector<uint32_t>& cpus)
+{
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (uint32_t cpu : cpus) {
+        CPU_SET(cpu, &cpuSet);
+    }
+    (void)sched_setaffinity(0, sizeof(cpuSet), &cpuSet);
+
+    void* copy = mmap(nullptr, source.fFileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (copy == MAP_FAILED) {
+        cerr << "mmap replica for node " << node << " failed: " << errno << endl;
+        return nullptr;
+    }
+    constexpr size_t maskBits = sizeof(unsigned long) * CHAR_BIT;
+    unsigned long nodeMask[CPU_SETSIZE / maskBits] = {};
+    nodeMask[node / maskBits] = 1UL << (node % maskBits);
+    // the kernel reads one bit less than maxnode
+    (void)syscall(SYS_mbind, copy, source.fFileSize, MPOL_BIND, nodeMask, CPU_SETSIZE + 1, 0);
+    memcpy(copy, source.fAddress, source.fFileSize);
+    (void)mprotect(copy, source.fFileSize, PROT_READ);
+
+    auto replica = make_unique<CodeInfo>();
+    replica->fVerbose = false;
+    replica->fAddress = static_cast<uint8_t*>(copy);
+    replica->fFileSize = source.fFileSize;
+    if (!ahoCorasick && replica->GetHeader() != SUCCEED) {
+        (void)munmap(copy, source.fFileSize);
+        return nullptr;
+    }
+    return replica;
+}
+
+// One copy per node, made in parallel by threads pinned to the nodes
+void HyphenDictionary::ReplicatePerNode()
+{
+    vector<uint32_t> nodes = ParseIdList(ReadFirstLine(NUMA_NODE_ROOT + "online"));
+    if (nodes.size() < 2) {
+        return;
+    }
+    // replicas are plain copies, compressed subtrees are inflated once before copying
+    const CodeInfo& source = *fCodeInfo;
+    if (source.fSubtrees) {
+        for (uint32_t entry = 0; entry < source.fSubtrees->fHeader->chunkCount; entry++) {
+            if (!source.fSubtrees->Expand(entry)) {
+                return;
+            }
+        }
+    }
+    vector<vector<uint32_t>> nodeCpus(nodes.size());
+    vector<uint16_t> cpuNodes;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        nodeCpus[i] = ParseIdList(ReadFirstLine(NUMA_NODE_ROOT + "node" + to_string(nodes[i]) + "/cpulist"));
+        for (uint32_t cpu : nodeCpus[i]) {
+            if (cpu >= cpuNodes.size()) {
+                cpuNodes.resize(cpu + 1, NO_NUMA_NODE);
+            }
+            cpuNodes[cpu] = static_cast<uint16_t>(nodes[i]);
+        }
+    }
+    fReplicas.resize(nodes.back() + 1);
+    vector<thread> copies;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        copies.emplace_back([this, &source, &nodes, &nodeCpus, i]() {
+            fReplicas[nodes[i]] = CopyToNode(source, fAhoCorasick, nodes[i], nodeCpus[i]);
+        });
+    }
+    for (auto& copy : copies) {
+        copy.join();
+    }
+    fCpuNodes = move(cpuNodes);
+}
+
+// The replica of the node the calling thread runs on, the mapping itself without one
+const CodeInfo& HyphenDictionary::LocalCodeInfo() const
+{
+    if (fReplicas.empty()) {
+        return *fCodeInfo;
+    }
+    int cpu = sched_getcpu();
+    if (cpu < 0 || static_cast<size_t>(cpu) >= fCpuNodes.size()) {
+        return *fCodeInfo;
+    }
+    uint16_t node = fCpuNodes[cpu];
+    if (node >= fReplicas.size() || !fReplicas[node]) {
+        return *fCodeInfo;
+    }
+    return *fReplicas[node];
+}
+
+std::shared_ptr<HyphenDictionary> HyphenDictionary::Open(const char* filePath, const HyphenOpenOptions& options)
+{
+    std::shared_ptr<HyphenDictionary> dictionary(new HyphenDictionary());
+    CodeInfo& codeInfo = *dictionary->fCodeInfo;
+    if (codeInfo.OpenPatFile(filePath, options.populate ? MAP_POPULATE : 0) != SUCCEED) {
+        return nullptr;
+    }
+    if (codeInfo.fFileSize >= sizeof(HbHeader) && codeInfo.fAddress[1] == HYPHEN_MAGIC_BUNDLE) {
+        cerr << filePath << " is a bundle, open it with HyphenBundle" << endl;
+        return nullptr;
+    }
+    if (dictionary->Prepare(options) != SUCCEED) {
+        return nullptr;
+    }
+    return dictionary;
+}
+
+std::shared_ptr<HyphenDictionary> HyphenDictionary::Open(std::shared_ptr<const HpbImage> image,
+                                                         const HyphenOpenOptions& options)
+{
+    if (!image || image->Size() < sizeof(Header) || CompressedSubtrees::IsCompressed(image->Data(), image->Size()) ||
+        image->Data()[1] == HYPHEN_MAGIC_BUNDLE) {
+        cerr << "not a dictionary image" << endl;
+        return nullptr;
+    }
+    std::shared_ptr<HyphenDictionary> dictionary(new HyphenDictionary());
+    CodeInfo& codeInfo = *dictionary->fCodeInfo;
+    // read only like a mapping, the CodeInfo does not own it
+    codeInfo.fAddress = const_cast<uint8_t*>(image->Data());
+    codeInfo.fFileSize = image->Size();
+    dictionary->fImage = std::move(image);
+    if (dictionary->Prepare(options) != SUCCEED) {
+        return nullptr;
+    }
+    return dictionary;
+}
+
+int32_t HyphenDictionary::Prepare(const HyphenOpenOptions& options)
+{
+    CodeInfo& codeInfo = *fCodeInfo;
+    fAhoCorasick = IsAhoCorasick(codeInfo);
+    if (!fAhoCorasick && codeInfo.GetHeader() != SUCCEED) {
         return FAILED;
     }
+    if (options.willNeed) {
+        (void)madvise(codeInfo.fAddress, codeInfo.fFileSize, MADV_WILLNEED);
+    }
+    if (options.lockMetadata) {
+        LockMetadata();
+    }
+    if (options.replicatePerNode) {
+        ReplicatePerNode();
+    }
+    if (!options.startupProfile.empty()) {
+        fWarmUp = std::thread(&HyphenDictionary::WarmUp, this, options.startupProfile);
+    } else {
+        fWarmedUp = true;
+    }
+    return SUCCEED;
+}
 
-    OHOS::Hyphenate::HyphenReader hyphenReader;
-    return hyphenReader.Read(argv[1], target);
+std::future<std::shared_ptr<HyphenDictionary>> HyphenDictionary::OpenAsync(const std::string& filePath,
+                                                                           const HyphenOpenOptions& options)
+{
+    return std::async(std::launch::async, [filePath, options]() { return Open(filePath.c_str(), options); });
 }
+
+void HyphenDictionary::OpenAsync(const std::string& filePath, const HyphenOpenOptions& options,
+                                 std::function<void(std::shared_ptr<HyphenDictionary>)> callback)
+{
+    std::thread([filePath, options, callback]() { callback(Open(filePath.c_str(), options)); }).detach();
+}
+
+bool HyphenDictionary::IsWarmedUp() const
+{
+    return fWarmedUp;
+}
+
+std::vector<HyphenPageRange> HyphenDictionary::RecordStartupProfile() const
+{
+    std::vector<HyphenPageRange> profile;
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t pages = (fCodeInfo->fFileSize + pageSize - 1) / pageSize;
+    std::vector<unsigned char> resident(pages, 0);
+    if (mincore(fCodeInfo->fAddress, fCodeInfo->fFileSize, resident.data()) != 0) {
+        cerr << "mincore failed: " << errno << endl;
+        return profile;
+    }
+    for (size_t page = 0; page < pages; page++) {
+        if ((resident[page] & 0x1) == 0) {
+            continue;
+        }
+        if (!profile.empty() && profile.back().offset + profile.back().length == page * pageSize) {
+            profile.back().length += pageSize;
+        } else {
+            profile.push_back({page * pageSize, pageSize});
+        }
+    }
+    return profile;
+}
+
+int32_t HyphenDictionary::SaveStartupProfile(const char* filePath, const std::vector<HyphenPageRange>& profile)
+{
+    ofstream out(filePath);
+    if (!out.good()) {
+        cerr << "could not open '" << filePath << "' for writing" << endl;
+        return FAILED;
+    }
+    for (const auto& range : profile) {
+        out << range.offset << " " << range.length << "\n";
+    }
+    return out.good() ? SUCCEED : FAILED;
+}
+
+int32_t HyphenDictionary::LoadStartupProfile(const char* filePath, std::vector<HyphenPageRange>& profile)
+{
+    ifstream input(filePath);
+    if (!input.good()) {
+        cerr << "could not open '" << filePath << "' for reading" << endl;
+        return FAILED;
+    }
+    HyphenPageRange range;
+    while (input >> range.offset >> range.length) {
+        profile.push_back(range);
+    }
+    return SUCCEED;
+}
+
+int32_t HyphenDictionary::Hyphenate(const std::vector<uint16_t>& utf16Target, std::vector<uint8_t>& result) const
+{
+    result.assign(utf16Target.size(), 0);
+    const CodeInfo& codeInfo = LocalCodeInfo();
+    if (fAhoCorasick) {
+        AcMatcher(codeInfo.fAddress).Process(utf16Target, result.data());
+        return SUCCEED;
+    }
+    codeInfo.fKernel(codeInfo, &utf16Target, &result, 1);
+    return SUCCEED;
+}
+
+int32_t HyphenDictionary::HyphenateBatch(const std::vector<std::vector<uint16_t>>& utf16Targets,
+                                         std::vector<std::vector<uint8_t>>& results) const
+{
+    results.clear();
+    for (const auto& target : utf16Targets) {
+        results.emplace_back(target.size(), 0);
+    }
+    const CodeInfo& codeInfo = LocalCodeInfo();
+    if (fAhoCorasick) {
+        AcMatcher matcher(codeInfo.fAddress);
+        for (size_t i = 0; i < utf16Targets.size(); i++) {
+            matcher.Process(utf16Targets[i], results[i].data());
+        }
+    } else {
+        codeInfo.fKernel(codeInfo, utf16Targets.data(), results.data(), utf16Targets.size());
+    }
+    return SUCCEED;
+}
+
+// Longest path followed when decompiling, guards against malformed files
+constexpr size_t MAX_DECOMPILE_DEPTH = 0xff;
+
+// The trie is walked from the pattern end, codes holds the path in that order
+static void AppendStoredPattern(const CodeInfo& dict, uint16_t poffset, const std::vector<uint16_t>& codes,
+                                std::vector<HyphenStoredPattern>& patterns)
+{
+    size_t count = (poffset >> 0xc) * 0x4;
+    if (count == 0) {
+        return;
+    }
+    const uint8_t* levels = dict.fRules + (poffset & 0xfff);
+    uint8_t unpacked[MAX_RULE_LEVELS + SIMD_WIDTH];
+    if (dict.fHeader->HasFlag(HYPHEN_FLAG_NIBBLE_RULES)) {
+        count *= HYPHEN_BASE_CODE_SHIFT;
+        UnpackNibbles(levels, count, unpacked);
+        levels = unpacked;
+    }
+    patterns.push_back(
+        {std::vector<uint16_t>(codes.rbegin(), codes.rend()), std::vector<uint8_t>(levels, levels + count)});
+}
+
+// Visits every node below the cursor the same way StepCursor resolves them
+static void CollectStoredPatterns(const CodeInfo& dict, TrieCursor cursor, std::vector<uint16_t>& codes,
+                                  std::vector<HyphenStoredPattern>& patterns)
+{
+    if (codes.size() > MAX_DECOMPILE_DEPTH) {
+        return;
+    }
+    AppendStoredPattern(dict, *CursorNode(dict, cursor), codes, patterns);
+    cursor.nextOffset++;
+    auto visit = [&dict, &cursor, &codes, &patterns](uint16_t code, uint16_t value) {
+        TrieCursor child = cursor;
+        child.nextOffset = value & 0x3fff;
+        child.type = static_cast<PathType>(value >> SHIFT_BITS_14);
+        codes.push_back(code);
+        CollectStoredPatterns(dict, child, codes, patterns);
+        codes.pop_back();
+    };
+    if (cursor.type == PathType::DIRECT) {
+        for (uint16_t code = dict.fHeader->minCp; code <= dict.fHeader->maxCp; code++) {
+            uint16_t value = *(cursor.staticOffset + cursor.nextOffset + dict.fHeader->CodeOffset(code));
+            if (value != 0) {
+                visit(code, value);
+            }
+        }
+    } else if (cursor.type == PathType::PAIRS) {
+        auto p = reinterpret_cast<const ArrayOf16bits*>(cursor.staticOffset + cursor.nextOffset);
+        uint16_t count = p->count & ~PAIRS_FREQUENCY_ORDER;
+        for (size_t j = 0; j < count; j += HYPHEN_BASE_CODE_SHIFT) {
+            visit(p->codes[j], p->codes[j + 1]);
+        }
+    } else if (cursor.type == PathType::LINEAR) {
+        size_t depth = codes.size();
+        do {
+            auto p = reinterpret_cast<const ArrayOf16bits*>(cursor.staticOffset + cursor.nextOffset);
+            uint16_t count = p->count & ~LINEAR_CONTINUATION;
+            if ((p->count & LINEAR_CONTINUATION) != 0) {
+                // the last code is the one of the branching node
+                codes.insert(codes.end(), p->codes, p->codes + count - 1);
+                visit(p->codes[count - 1], p->codes[count]);
+                break;
+            }
+            codes.insert(codes.end(), p->codes, p->codes + count);
+            cursor.nextOffset += count + 1;
+            AppendStoredPattern(dict, *(cursor.staticOffset + cursor.nextOffset), codes, patterns);
+            cursor.nextOffset++;
+        } while (*(cursor.staticOffset + cursor.nextOffset) != 0 && codes.size() <= MAX_DECOMPILE_DEPTH);
+        codes.resize(depth);
+    }
+}
+
+static void CollectStoredPatterns(const AcMatcher& matcher, uint32_t state, std::vector<uint16_t>& codes,
+                                  std::vector<HyphenStoredPattern>& patterns)
+{
+    const AcState& current = matcher.fStates[state];
+    if (current.ruleCount != 0) {
+        size_t count = current.ruleCount;
+        const uint8_t* levels = matcher.fRules + current.rule;
+        uint8_t unpacked[MAX_RULE_LEVELS + SIMD_WIDTH];
+        if ((matcher.fHeader->flags & HYPHEN_FLAG_NIBBLE_RULES) != 0) {
+            count = min(count, MAX_RULE_LEVELS);
+            UnpackNibbles(levels, count, unpacked);
+            levels = unpacked;
+        }
+        patterns.push_back({codes, std::vector<uint8_t>(levels, levels + count)});
+    }
+    for (uint32_t i = current.edges; i < current.edges + current.edgeCount; i++) {
+        // goto edges only, the depth grows by one along the trie
+        uint32_t next = matcher.fTargets[i];
+        if (next < matcher.fHeader->stateCount && matcher.fStates[next].depth == codes.size() + 1 &&
+            codes.size() < MAX_DECOMPILE_DEPTH) {
+            codes.push_back(matcher.fCodes[i]);
+            CollectStoredPatterns(matcher, next, codes, patterns);
+            codes.pop_back();
+        }
+    }
+}
+
+int32_t HyphenDictionary::Decompile(std::vector<HyphenStoredPattern>& patterns) const
+{
+    patterns.clear();
+    const CodeInfo& codeInfo = *fCodeInfo;
+    std::vector<uint16_t> codes;
+    if (fAhoCorasick) {
+        CollectStoredPatterns(AcMatcher(codeInfo.fAddress), 0, codes, patterns);
+        return SUCCEED;
+    }
+    const uint32_t* toc = reinterpret_cast<const uint32_t*>(codeInfo.fAddress + codeInfo.fHeader->toc);
+    for (uint16_t code : GetCoverage()) {
+        uint16_t offset = codeInfo.fHeader->CodeOffset(code, codeInfo.fMappings);
+        if (offset == codeInfo.fMaxCount || !codeInfo.ExpandSubtree(offset)) {
+            continue;
+        }
+        TrieCursor cursor;
+        uint32_t initialValue = toc[offset];
+        cursor.type = static_cast<PathType>(initialValue >> SHIFT_BITS_30);
+        if (initialValue == 0 && (cursor.type == PathType::DIRECT || cursor.type == PathType::PAIRS)) {
+            continue;
+        }
+        cursor.staticOffset =
+            reinterpret_cast<const uint16_t*>(codeInfo.fAddress + HYPHEN_BASE_CODE_SHIFT * toc[offset - 1]);
+        cursor.nextOffset = initialValue & 0x3fffffff;
+        codes.assign(1, code);
+        CollectStoredPatterns(codeInfo, cursor, codes, patterns);
+    }
+    return SUCCEED;
+}
+
+std::vector<uint16_t> HyphenDictionary::GetCoverage() const
+{
+    std::vector<uint16_t> coverage;
+    const CodeInfo& codeInfo = *fCodeInfo;
+    if (fAhoCorasick) {
+        AcMatcher matcher(codeInfo.fAddress);
+        for (uint32_t i = 0; i < matcher.fHeader->stateCount; i++) {
+            const AcState& state = matcher.fStates[i];
+            coverage.insert(coverage.end(), matcher.fCodes + state.edges, matcher.fCodes + state.edges + state.edgeCount);
+        }
+    } else {
+        // without a direct range minCp equals maxCp, all codes are mapped
+        for (uint16_t code = codeInfo.fHeader->minCp;
+             codeInfo.fHeader->minCp != codeInfo.fHeader->maxCp && code <= codeInfo.fHeader->maxCp; code++) {
+            coverage.push_back(code);
+        }
+        for (size_t i = 0; i < codeInfo.fMappings->count; i += HYPHEN_BASE_CODE_SHIFT) {
+            coverage.push_back(codeInfo.fMappings->codes[i]);
+        }
+    }
+    sort(coverage.begin(), coverage.end());
+    coverage.erase(unique(coverage.begin(), coverage.end()), coverage.end());
+    return coverage;
+}
+
+void HyphenBreakMasks::Append(const std::vector<uint8_t>& levels, const HyphenBreakOptions& options)
+{
+    Append(levels.data(), levels.size(), options);
+}
+
+void HyphenBreakMasks::Append(const uint8_t* levels, size_t count, const HyphenBreakOptions& options)
+{
+    constexpr size_t maskBits = 64;
+    // levels of the word itself start after the leading delimiter
+    size_t size = count > HYPHEN_BASE_CODE_SHIFT ? count - HYPHEN_BASE_CODE_SHIFT : 0;
+    size_t first = max<size_t>(options.leftMin, 1);
+    size_t last = size >= options.rightMin ? size - options.rightMin : 0; // inclusive
+    offsets.push_back(static_cast<uint32_t>(bits.size()));
+    for (size_t base = 0; base == 0 || base < size; base += maskBits) {
+        size_t bitCount = size > base ? min(maskBits, size - base) : 0;
+        uint64_t mask = bitCount == 0 ? 0 : OddLevelBits(levels + 1 + base, bitCount);
+        // keep positions first..last of this word of the mask
+        if (first > base) {
+            mask = first - base >= maskBits ? 0 : mask & (~0ULL << (first - base));
+        }
+        if (last < base) {
+            mask = 0;
+        } else if (last - base < maskBits - 1) {
+            mask &= ~0ULL >> (maskBits - 1 - (last - base));
+        }
+        bits.push_back(mask);
+    }
+}
+
+int32_t HyphenDictionary::HyphenateMasks(const std::vector<std::vector<uint16_t>>& utf16Targets,
+                                         HyphenBreakMasks& masks, const HyphenBreakOptions& options) const
+{
+    return HyphenateMasks(utf16Targets.data(), utf16Targets.size(), masks, options);
+}
+
+int32_t HyphenDictionary::HyphenateMasks(const std::vector<uint16_t>* utf16Targets, size_t count,
+                                         HyphenBreakMasks& masks, const HyphenBreakOptions& options) const
+{
+    // per thread, so that the workers of a document reuse their scratch levels
+    static thread_local MaskWindow window;
+    masks.Clear();
+    masks.offsets.reserve(count);
+    window.Reset(utf16Targets, masks, options);
+    const CodeInfo& codeInfo = LocalCodeInfo();
+    if (fAhoCorasick) {
+        AcMatcher matcher(codeInfo.fAddress);
+        for (size_t i = 0; i < count; i++) {
+            auto& levels = window.Scratch(utf16Targets[i].size());
+            matcher.Process(utf16Targets[i], levels.data());
+            masks.Append(levels, options);
+        }
+    } else {
+        codeInfo.fMaskKernel(codeInfo, utf16Targets, count, window);
+    }
+    return SUCCEED;
+}
+
+HyphenBundle::HyphenBundle() : fCodeInfo(make_unique<CodeInfo>())
+{
+    fCodeInfo->fVerbose = false;
+}
+
+HyphenBundle::~HyphenBundle()
+{
+    // dictionaries only borrow the mapping
+    fDictionaries.clear();
+    if (fCodeInfo->fAddress) {
+        fCodeInfo->ClearResource();
+    }
+}
+
+std::shared_ptr<HyphenBundle> HyphenBundle::Open(const char* filePath, const HyphenOpenOptions& options)
+{
+    std::shared_ptr<HyphenBundle> bundle(new HyphenBundle());
+    CodeInfo& codeInfo = *bundle->fCodeInfo;
+    if (codeInfo.OpenPatFile(filePath, options.populate ? MAP_POPULATE : 0) != SUCCEED) {
+        return nullptr;
+    }
+    auto header = reinterpret_cast<const HbHeader*>(codeInfo.fAddress);
+    if (codeInfo.fFileSize < sizeof(HbHeader) || header->magic1 != HYPHEN_MAGIC ||
+        header->magic2 != HYPHEN_MAGIC_BUNDLE || header->version != BUNDLE_VERSION ||
+        header->languages + header->languageCount * sizeof(HbLanguage) > codeInfo.fFileSize) {
+        cerr << filePath << " is not a hyphenation bundle" << endl;
+        return nullptr;
+    }
+    if (options.willNeed) {
+        (void)madvise(codeInfo.fAddress, codeInfo.fFileSize, MADV_WILLNEED);
+    }
+
+    auto languages = reinterpret_cast<const HbLanguage*>(codeInfo.fAddress + header->languages);
+    for (uint32_t i = 0; i < header->languageCount; i++) {
+        const HbLanguage& language = languages[i];
+        if (language.image < language.split || language.rules + language.split > codeInfo.fFileSize ||
+            language.image + (language.size - language.split) > codeInfo.fFileSize) {
+            cerr << "corrupted bundle entry " << i << endl;
+            return nullptr;
+        }
+        // resolve the language as if it was a file of its own starting at 'image - split'
+        std::unique_ptr<HyphenDictionary> dictionary(new HyphenDictionary());
+        CodeInfo& part = *dictionary->fCodeInfo;
+        part.fAddress = codeInfo.fAddress + language.image - language.split;
+        part.fFileSize = language.size;
+        part.fHeader = reinterpret_cast<Header*>(const_cast<uint32_t*>(language.header));
+        part.fRules = codeInfo.fAddress + language.rules;
+        if (part.GetHeader() != SUCCEED) {
+            return nullptr;
+        }
+        dictionary->fWarmedUp = true;
+        bundle->fDictionaries.emplace(string(language.name, strnlen(language.name, BUNDLE_NAME_SIZE)),
+                                      std::move(dictionary));
+    }
+    return bundle;
+}
+
+std::vector<std::string> HyphenBundle::GetLanguages() const
+{
+    std::vector<std::string> languages;
+    for (const auto& dictionary : fDictionaries) {
+        languages.push_back(dictionary.first);
+    }
+    return languages;
+}
+
+std::shared_ptr<const HyphenDictionary> HyphenBundle::GetDictionary(const std::string& language) const
+{
+    auto ite = fDictionaries.find(language);
+    if (ite == fDictionaries.cend()) {
+        return nullptr;
+    }
+    // shares the ownership of the bundle
+    return std::shared_ptr<const HyphenDictionary>(shared_from_this(), ite->second.get());
+}
+} // namespace OHOS::Hyphenate
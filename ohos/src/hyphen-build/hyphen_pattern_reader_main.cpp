@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hyphen_document.h"
+#include "hyphen_materialize.h"
+#include "hyphen_pattern.h"
+#include "hyphen_router.h"
+#include "hyphen_text_pipeline.h"
+#include "hyphen_user_dictionary.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unicode/utf16.h>
+#include <unicode/utf8.h>
+
+using namespace std;
+
+namespace {
+constexpr size_t ARG_NUM = 2;
+constexpr int32_t BATCH_ARG_NUM = 3;
+
+// exceptions ("ta-ble") and patterns (".ta1b") one per line
+int32_t ReadUserEntries(const char* filePath, std::vector<std::string>& entries)
+{
+    ifstream input(filePath);
+    if (!input.is_open()) {
+        cerr << "could not open user dictionary " << filePath << endl;
+        return FAILED;
+    }
+    for (std::string line; getline(input, line);) {
+        if (!line.empty() && line[0] != '%') {
+            entries.push_back(line);
+        }
+    }
+    return SUCCEED;
+}
+
+bool IsBundle(const char* filePath)
+{
+    char magic[OHOS::Hyphenate::HYPHEN_BASE_CODE_SHIFT] = {0};
+    ifstream input(filePath, ios::binary);
+    return input.read(magic, sizeof(magic)) && magic[1] == OHOS::Hyphenate::HYPHEN_MAGIC_BUNDLE;
+}
+
+// comma separated list of dictionaries or a bundle, each word goes to the one covering its script
+int32_t RouteWords(const std::string& filePaths, const std::vector<std::vector<uint16_t>>& targets,
+                   std::vector<std::vector<uint8_t>>& results)
+{
+    OHOS::Hyphenate::HyphenRouter router;
+    if (IsBundle(filePaths.c_str())) {
+        auto bundle = OHOS::Hyphenate::HyphenBundle::Open(filePaths.c_str());
+        if (bundle == nullptr) {
+            return FAILED;
+        }
+        for (const auto& language : bundle->GetLanguages()) {
+            router.AddDictionary(bundle->GetDictionary(language));
+        }
+        return router.HyphenateBatch(targets, results);
+    }
+    size_t start = 0;
+    while (start <= filePaths.size()) {
+        size_t end = filePaths.find(',', start);
+        end = end == std::string::npos ? filePaths.size() : end;
+        std::string filePath = filePaths.substr(start, end - start);
+        if (router.AddDictionary(OHOS::Hyphenate::HyphenDictionary::Open(filePath.c_str())) ==
+            OHOS::Hyphenate::HYPHEN_NO_ROUTE) {
+            cerr << "could not open " << filePath << endl;
+            return FAILED;
+        }
+        start = end + 1;
+    }
+    return router.HyphenateBatch(targets, results);
+}
+
+int32_t ReadWords(int argc, char** argv)
+{
+    int32_t first = BATCH_ARG_NUM;
+    std::vector<std::string> entries;
+    if (argc > first + 1 && std::string(argv[first]) == "--user") {
+        if (ReadUserEntries(argv[first + 1], entries) != SUCCEED) {
+            return FAILED;
+        }
+        first += ARG_NUM;
+    }
+    std::vector<std::vector<uint16_t>> targets;
+    for (int32_t i = first; i < argc; i++) {
+        targets.push_back(OHOS::Hyphenate::GetInputWord(argv[i], false));
+    }
+    std::vector<std::vector<uint8_t>> results;
+    if (std::string(argv[ARG_NUM]).find(',') != std::string::npos || IsBundle(argv[ARG_NUM])) {
+        if (RouteWords(argv[ARG_NUM], targets, results) != SUCCEED) {
+            return FAILED;
+        }
+    } else if (entries.empty()) {
+        OHOS::Hyphenate::HyphenReader hyphenReader;
+        if (hyphenReader.ReadBatch(argv[ARG_NUM], targets, results) != SUCCEED) {
+            return FAILED;
+        }
+    } else {
+        OHOS::Hyphenate::HyphenUserDictionary user(OHOS::Hyphenate::HyphenDictionary::Open(argv[ARG_NUM]));
+        if (user.AddEntries(entries) != SUCCEED || user.HyphenateBatch(targets, results) != SUCCEED) {
+            return FAILED;
+        }
+    }
+    for (size_t i = 0; i < results.size(); i++) {
+        cout << argv[first + i] << ":";
+        for (auto level : results[i]) {
+            cout << " " << static_cast<int>(level);
+        }
+        cout << endl;
+    }
+    return SUCCEED;
+}
+
+// every word of a UTF-8 text file on its own line, with '-' at the breaks
+int32_t HyphenateDocument(int argc, char** argv)
+{
+    ifstream input(argv[BATCH_ARG_NUM], ios::binary);
+    if (!input.is_open()) {
+        cerr << "could not open " << argv[BATCH_ARG_NUM] << endl;
+        return FAILED;
+    }
+    std::ostringstream text;
+    text << input.rdbuf();
+    const std::string document = text.str();
+    size_t threads = argc > BATCH_ARG_NUM + 1 ? std::stoul(argv[BATCH_ARG_NUM + 1]) : 0;
+    OHOS::Hyphenate::HyphenDocumentHyphenator hyphenator(OHOS::Hyphenate::HyphenDictionary::Open(argv[ARG_NUM]),
+                                                         threads);
+    OHOS::Hyphenate::HyphenDocumentIndex index;
+    auto start = std::chrono::steady_clock::now();
+    if (hyphenator.Hyphenate(document, index) != SUCCEED) {
+        return FAILED;
+    }
+    auto us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    for (const auto& word : index.words) {
+        size_t position = word.start;
+        for (size_t i = word.firstBreak; i < word.firstBreak + word.breakCount; i++) {
+            cout << document.substr(position, index.breaks[i] - position) << "-";
+            position = index.breaks[i];
+        }
+        cout << document.substr(position, word.start + word.length - position) << "\n";
+    }
+    cerr << index.words.size() << " words, " << index.breaks.size() << " breaks in " << us << " us on " <<
+        hyphenator.ThreadCount() << " threads" << endl;
+    return SUCCEED;
+}
+
+// running text segmented by ICU, printed with '-' at the breaks
+int32_t HyphenateText(char** argv)
+{
+    OHOS::Hyphenate::HyphenTextPipeline pipeline(OHOS::Hyphenate::HyphenDictionary::Open(argv[ARG_NUM]),
+                                                 argv[BATCH_ARG_NUM]);
+    std::vector<uint16_t> text = OHOS::Hyphenate::ConvertToUtf16(argv[BATCH_ARG_NUM + 1]);
+    std::vector<uint32_t> breaks;
+    if (pipeline.Hyphenate(text.data(), text.size(), breaks) != SUCCEED) {
+        return FAILED;
+    }
+    std::vector<uint16_t> hyphenated(OHOS::Hyphenate::HyphenatedSizeUtf16(text.size(), breaks.size(), '-'));
+    size_t written = 0;
+    if (OHOS::Hyphenate::WriteHyphenatedUtf16(text.data(), text.size(), breaks.data(), breaks.size(),
+                                              hyphenated.data(), hyphenated.size(), written, '-') != SUCCEED) {
+        return FAILED;
+    }
+    size_t i = 0;
+    while (i < written) {
+        UChar32 code = 0;
+        U16_NEXT(hyphenated.data(), i, written, code);
+        char buffer[U8_MAX_LENGTH];
+        int32_t length = 0;
+        U8_APPEND_UNSAFE(buffer, length, code);
+        cout << std::string(buffer, length);
+    }
+    cout << endl;
+    return SUCCEED;
+}
+
+std::vector<uint16_t> CheckArgs(int argc, char** argv)
+{
+    std::vector<uint16_t> target;
+    if (argc != 3) { // 3: valid argument number
+        cout << "usage: './hyphen hyph-en-us.hpb <mytestword>' or "
+                "'./hyphen --batch hyph-en-us.hpb[,hyph-ru.hpb...] [--user <entries>] <word> [<word>...]' or "
+                "'./hyphen --document hyph-en-us.hpb <utf8 text file> [threads]' or "
+                "'./hyphen --text hyph-en-us.hpb <locale> <text>'" << endl;
+        return target;
+    }
+    target = OHOS::Hyphenate::GetInputWord(argv[ARG_NUM]);
+    if (target.empty()) {
+        cout << "usage: './hyphen hyph-en-us.hpb <mytestword>' " << endl;
+    }
+    return target;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc > BATCH_ARG_NUM && std::string(argv[1]) == "--batch") {
+        return ReadWords(argc, argv);
+    }
+    if (argc > BATCH_ARG_NUM && std::string(argv[1]) == "--document") {
+        return HyphenateDocument(argc, argv);
+    }
+    if (argc == BATCH_ARG_NUM + ARG_NUM && std::string(argv[1]) == "--text") {
+        return HyphenateText(argv);
+    }
+    std::vector<uint16_t> target = CheckArgs(argc, argv);
+    if (target.empty()) {
+        return FAILED;
+    }
+
+    OHOS::Hyphenate::HyphenReader hyphenReader;
+    return hyphenReader.Read(argv[1], target);
+}
@@ -0,0 +1,574 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Generates hyphenation patterns from a hyphenated word list with Liang's method, as
+// patgen does: level by level, odd levels add the missing breaks and even levels
+// remove the wrong ones. Candidates are counted on all cores, every thread fills its
+// own open addressing count table which are merged after each pattern length. The
+// result is a .tex file with a \patterns section for hpb_transform.
+//
+// usage: hyphen_trainer [--threads N] [--left-min N] [--right-min N]
+//                       [--level min,max,good,bad,threshold]... <words.txt> <out.tex>
+// The word list holds one word per line with '-' at the breaks, as patterns/txt/*.hyp.txt.
+
+#include "hyphen_pattern.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unicode/uchar.h>
+#include <unicode/utf8.h>
+#include <vector>
+
+using namespace std;
+
+namespace OHOS::Hyphenate {
+namespace {
+// pattern keys hold up to 7 alphabet indices of 8 bits, the length and the dot
+constexpr size_t MAX_PATTERN_LENGTH = 7;
+constexpr size_t MAX_ALPHABET_SIZE = 0xff;
+constexpr uint32_t KEY_BITS = 64;
+constexpr uint32_t LETTER_BITS = 8;
+constexpr uint32_t LENGTH_SHIFT = 56;
+constexpr uint32_t DOT_SHIFT = 59;
+constexpr uint64_t PATTERN_MASK = (1ULL << DOT_SHIFT) - 1;
+// levels of a pattern, 4 bits for each of its positions
+constexpr uint32_t LEVEL_BITS = 4;
+constexpr uint32_t LEVEL_MASK = 0xf;
+constexpr uint32_t MAX_LEVEL = 9;
+constexpr size_t WORDS_PER_CHUNK = 256;
+
+struct TrainerLevel {
+    size_t minLength{2};
+    size_t maxLength{5};
+    uint32_t good{1};
+    uint32_t bad{1};
+    uint32_t threshold{1};
+};
+
+struct TrainerOptions {
+    size_t threads{0};
+    size_t leftMin{2};
+    size_t rightMin{2};
+    vector<TrainerLevel> levels;
+};
+
+// defaults of the classic patgen run for english
+const vector<TrainerLevel> DEFAULT_LEVELS = {
+    {2, 5, 1, 2, 20},
+    {2, 5, 2, 1, 8},
+    {2, 6, 1, 4, 7},
+    {2, 6, 3, 2, 1},
+};
+
+// dotted word as alphabet indices, index 0 is the word boundary '.'
+struct TrainingWord {
+    vector<uint8_t> letters;
+    // per gap, gap j lies between letters[j - 1] and letters[j]
+    vector<uint8_t> breaks;
+    vector<uint8_t> levels;
+};
+
+struct Counts {
+    uint32_t good{0};
+    uint32_t bad{0};
+};
+
+// Open addressing table with 64 bit keys, zero is never a valid key
+template <typename Value>
+class FlatTable {
+public:
+    const Value* Find(uint64_t key) const
+    {
+        if (fSize == 0) {
+            return nullptr;
+        }
+        for (size_t i = Slot(key);; i = (i + 1) & (fKeys.size() - 1)) {
+            if (fKeys[i] == key) {
+                return &fValues[i];
+            }
+            if (fKeys[i] == 0) {
+                return nullptr;
+            }
+        }
+    }
+
+    Value& operator[](uint64_t key)
+    {
+        // keep the load below one half
+        if ((fSize + 1) * 2 > fKeys.size()) {
+            Grow();
+        }
+        size_t i = Slot(key);
+        while (fKeys[i] != key && fKeys[i] != 0) {
+            i = (i + 1) & (fKeys.size() - 1);
+        }
+        if (fKeys[i] == 0) {
+            fKeys[i] = key;
+            fValues[i] = Value();
+            fSize++;
+        }
+        return fValues[i];
+    }
+
+    template <typename Visitor>
+    void ForEach(Visitor&& visitor) const
+    {
+        for (size_t i = 0; i < fKeys.size(); i++) {
+            if (fKeys[i] != 0) {
+                visitor(fKeys[i], fValues[i]);
+            }
+        }
+    }
+
+    size_t Size() const
+    {
+        return fSize;
+    }
+
+    void Clear()
+    {
+        fKeys.clear();
+        fValues.clear();
+        fSize = 0;
+    }
+
+private:
+    size_t Slot(uint64_t key) const
+    {
+        constexpr uint64_t fibonacci = 0x9e3779b97f4a7c15ULL;
+        return static_cast<size_t>((key * fibonacci) >> (KEY_BITS - fShift));
+    }
+
+    void Grow()
+    {
+        constexpr uint32_t initialShift = 10;
+        vector<uint64_t> keys;
+        vector<Value> values;
+        keys.swap(fKeys);
+        values.swap(fValues);
+        fShift = keys.empty() ? initialShift : fShift + 1;
+        fKeys.assign(size_t(1) << fShift, 0);
+        fValues.resize(fKeys.size());
+        fSize = 0;
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (keys[i] != 0) {
+                (*this)[keys[i]] = values[i];
+            }
+        }
+    }
+
+    vector<uint64_t> fKeys;
+    vector<Value> fValues;
+    size_t fSize{0};
+    uint32_t fShift{0};
+};
+
+uint64_t PatternKey(const uint8_t* letters, size_t length)
+{
+    uint64_t key = static_cast<uint64_t>(length) << LENGTH_SHIFT;
+    for (size_t k = 0; k < length; k++) {
+        key |= static_cast<uint64_t>(letters[k]) << (LETTER_BITS * k);
+    }
+    return key;
+}
+
+// runs work(thread, word) over all words, threads take chunks of words as they go
+template <typename Work>
+void ForEachWord(vector<TrainingWord>& words, size_t threads, Work&& work)
+{
+    atomic<size_t> next{0};
+    auto run = [&words, &next, &work](size_t thread) {
+        for (size_t begin = next.fetch_add(WORDS_PER_CHUNK); begin < words.size();
+             begin = next.fetch_add(WORDS_PER_CHUNK)) {
+            for (size_t i = begin; i < min(begin + WORDS_PER_CHUNK, words.size()); i++) {
+                work(thread, words[i]);
+            }
+        }
+    };
+    vector<thread> workers;
+    for (size_t thread = 1; thread < threads; thread++) {
+        workers.emplace_back(run, thread);
+    }
+    run(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+class PatternTrainer {
+public:
+    explicit PatternTrainer(const TrainerOptions& options) : fOptions(options) {}
+
+    int32_t ReadWords(const string& filePath);
+    int32_t Train();
+    int32_t WriteTex(const string& filePath, const string& source) const;
+
+private:
+    bool InRange(const TrainingWord& word, size_t gap) const;
+    bool Eligible(const TrainingWord& word, size_t gap, uint32_t level, bool& good) const;
+    bool Hopeless(const uint8_t* letters, size_t start, size_t length, size_t gap, size_t minLength) const;
+    void Count(const TrainingWord& word, uint32_t level, size_t length, size_t minLength,
+               FlatTable<Counts>& counts) const;
+    size_t Select(const vector<FlatTable<Counts>>& counts, const TrainerLevel& params, uint32_t level,
+                  size_t& candidates);
+    void Apply(TrainingWord& word) const;
+    void Report(uint32_t level);
+
+    TrainerOptions fOptions;
+    vector<UChar32> fAlphabet{'.'};
+    map<UChar32, uint8_t> fIndices{{'.', 0}};
+    vector<TrainingWord> fWords;
+    // accepted patterns with their packed levels
+    FlatTable<uint32_t> fPatterns;
+    // candidates of the current level that can not reach the threshold, neither can their extensions
+    FlatTable<uint8_t> fHopeless;
+};
+
+int32_t PatternTrainer::ReadWords(const string& filePath)
+{
+    ifstream input(filePath);
+    if (!input.is_open()) {
+        cerr << "could not open '" << filePath << "' for reading" << endl;
+        return FAILED;
+    }
+    size_t skipped = 0;
+    for (string line; getline(input, line);) {
+        if (line.empty() || line[0] == '%') {
+            continue;
+        }
+        TrainingWord word;
+        word.letters.push_back(0);
+        word.breaks.push_back(0);
+        bool valid = true;
+        uint8_t marked = 0;
+        int32_t i = 0;
+        int32_t length = static_cast<int32_t>(line.size());
+        while (i < length) {
+            UChar32 code = 0;
+            U8_NEXT(line.c_str(), i, length, code);
+            if (code == '-') {
+                marked = 1;
+                continue;
+            }
+            if (u_isUWhiteSpace(code)) {
+                continue;
+            }
+            // patterns hold 16 bit code units only, digits and dots have a meaning in them
+            code = u_tolower(code);
+            if (code < 0 || code > 0xffff || code == '.' || u_isdigit(code)) {
+                valid = false;
+                break;
+            }
+            auto index = fIndices.find(code);
+            if (index == fIndices.end()) {
+                if (fAlphabet.size() == MAX_ALPHABET_SIZE) {
+                    cerr << "more than " << MAX_ALPHABET_SIZE << " letters in " << filePath << endl;
+                    return FAILED;
+                }
+                index = fIndices.emplace(code, static_cast<uint8_t>(fAlphabet.size())).first;
+                fAlphabet.push_back(code);
+            }
+            word.letters.push_back(index->second);
+            word.breaks.push_back(marked);
+            marked = 0;
+        }
+        if (!valid || word.letters.size() == 1) {
+            skipped++;
+            continue;
+        }
+        // a break marked before the first letter or after the last one is ignored
+        word.breaks[1] = 0;
+        word.letters.push_back(0);
+        word.breaks.push_back(0);
+        fWords.push_back(move(word));
+    }
+    cout << "Read " << fWords.size() << " words over " << fAlphabet.size() - 1 << " letters, skipped " << skipped <<
+        endl;
+    return fWords.empty() ? FAILED : SUCCEED;
+}
+
+// gap j is the break before the letter j - 1 of the plain word
+bool PatternTrainer::InRange(const TrainingWord& word, size_t gap) const
+{
+    size_t length = word.letters.size() - 2;
+    return gap >= max<size_t>(fOptions.leftMin, 1) + 1 && gap + max<size_t>(fOptions.rightMin, 1) <= length + 1;
+}
+
+// whether the gap takes part at this level and if changing it would be good or bad
+bool PatternTrainer::Eligible(const TrainingWord& word, size_t gap, uint32_t level, bool& good) const
+{
+    if (!InRange(word, gap)) {
+        return false;
+    }
+    bool hyphenated = (word.levels[gap] & 1) != 0;
+    bool odd = (level & 1) != 0;
+    if (hyphenated == odd) {
+        return false;
+    }
+    good = odd == (word.breaks[gap] != 0);
+    return true;
+}
+
+bool PatternTrainer::Hopeless(const uint8_t* letters, size_t start, size_t length, size_t gap,
+                              size_t minLength) const
+{
+    if (fHopeless.Size() == 0) {
+        return false;
+    }
+    for (size_t shorter = minLength; shorter < length; shorter++) {
+        size_t first = max(start, gap >= shorter ? gap - shorter : 0);
+        size_t last = min(start + length - shorter, gap);
+        for (size_t s = first; s <= last; s++) {
+            uint64_t key = PatternKey(letters + s, shorter) | (static_cast<uint64_t>(gap - s) << DOT_SHIFT);
+            if (fHopeless.Find(key) != nullptr) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void PatternTrainer::Count(const TrainingWord& word, uint32_t level, size_t length, size_t minLength,
+                           FlatTable<Counts>& counts) const
+{
+    size_t size = word.letters.size();
+    for (size_t gap = 1; gap < size; gap++) {
+        bool good = false;
+        if (!Eligible(word, gap, level, good)) {
+            continue;
+        }
+        for (size_t dot = 0; dot <= length && dot <= gap; dot++) {
+            size_t start = gap - dot;
+            if (start + length > size || Hopeless(word.letters.data(), start, length, gap, minLength)) {
+                continue;
+            }
+            uint64_t key = PatternKey(word.letters.data() + start, length) | (static_cast<uint64_t>(dot) << DOT_SHIFT);
+            Counts& entry = counts[key];
+            (good ? entry.good : entry.bad)++;
+        }
+    }
+}
+
+size_t PatternTrainer::Select(const vector<FlatTable<Counts>>& counts, const TrainerLevel& params, uint32_t level,
+                              size_t& candidates)
+{
+    FlatTable<Counts> merged;
+    for (const auto& table : counts) {
+        table.ForEach([&merged](uint64_t key, const Counts& value) {
+            Counts& entry = merged[key];
+            entry.good += value.good;
+            entry.bad += value.bad;
+        });
+    }
+    candidates = merged.Size();
+    size_t accepted = 0;
+    merged.ForEach([this, &params, level, &accepted](uint64_t key, const Counts& value) {
+        uint64_t good = static_cast<uint64_t>(value.good) * params.good;
+        uint64_t bad = static_cast<uint64_t>(value.bad) * params.bad;
+        if (good < params.threshold) {
+            fHopeless[key] = 1;
+        } else if (good >= bad + params.threshold) {
+            uint32_t shift = LEVEL_BITS * static_cast<uint32_t>(key >> DOT_SHIFT);
+            uint32_t& levels = fPatterns[key & PATTERN_MASK];
+            levels = (levels & ~(LEVEL_MASK << shift)) | (level << shift);
+            accepted++;
+        }
+    });
+    return accepted;
+}
+
+// levels of all gaps of the word with the patterns accepted so far
+void PatternTrainer::Apply(TrainingWord& word) const
+{
+    size_t size = word.letters.size();
+    word.levels.assign(size + 1, 0);
+    for (size_t start = 0; start < size; start++) {
+        for (size_t length = 1; length <= MAX_PATTERN_LENGTH && start + length <= size; length++) {
+            const uint32_t* levels = fPatterns.Find(PatternKey(word.letters.data() + start, length));
+            if (levels == nullptr) {
+                continue;
+            }
+            for (size_t k = 0; k <= length; k++) {
+                uint8_t value = static_cast<uint8_t>((*levels >> (LEVEL_BITS * k)) & LEVEL_MASK);
+                word.levels[start + k] = max(word.levels[start + k], value);
+            }
+        }
+    }
+}
+
+void PatternTrainer::Report(uint32_t level)
+{
+    size_t found = 0;
+    size_t wrong = 0;
+    size_t missed = 0;
+    for (const auto& word : fWords) {
+        for (size_t gap = 1; gap < word.letters.size(); gap++) {
+            if (!InRange(word, gap)) {
+                continue;
+            }
+            bool hyphenated = (word.levels[gap] & 1) != 0;
+            if (word.breaks[gap] != 0) {
+                (hyphenated ? found : missed)++;
+            } else if (hyphenated) {
+                wrong++;
+            }
+        }
+    }
+    cout << "level " << level << ": " << fPatterns.Size() << " patterns, " << found << " good, " << wrong <<
+        " bad, " << missed << " missed breaks" << endl;
+}
+
+int32_t PatternTrainer::Train()
+{
+    size_t threads = fOptions.threads != 0 ? fOptions.threads : max<size_t>(thread::hardware_concurrency(), 1);
+    ForEachWord(fWords, threads, [this](size_t, TrainingWord& word) { Apply(word); });
+    vector<FlatTable<Counts>> counts(threads);
+    for (uint32_t level = 1; level <= fOptions.levels.size(); level++) {
+        const TrainerLevel& params = fOptions.levels[level - 1];
+        fHopeless.Clear();
+        for (size_t length = params.minLength; length <= params.maxLength; length++) {
+            for (auto& table : counts) {
+                table.Clear();
+            }
+            ForEachWord(fWords, threads, [this, &counts, level, length, &params](size_t thread, TrainingWord& word) {
+                Count(word, level, length, params.minLength, counts[thread]);
+            });
+            size_t candidates = 0;
+            size_t accepted = Select(counts, params, level, candidates);
+            cout << "level " << level << " length " << length << ": " << candidates << " candidates, " << accepted <<
+                " accepted" << endl;
+            if (accepted != 0) {
+                ForEachWord(fWords, threads, [this](size_t, TrainingWord& word) { Apply(word); });
+            }
+        }
+        Report(level);
+    }
+    return SUCCEED;
+}
+
+int32_t PatternTrainer::WriteTex(const string& filePath, const string& source) const
+{
+    vector<string> patterns;
+    fPatterns.ForEach([this, &patterns](uint64_t key, uint32_t levels) {
+        size_t length = static_cast<size_t>(key >> LENGTH_SHIFT);
+        string pattern;
+        for (size_t k = 0; k <= length; k++) {
+            uint32_t level = (levels >> (LEVEL_BITS * k)) & LEVEL_MASK;
+            if (level != 0) {
+                pattern += static_cast<char>('0' + level);
+            }
+            if (k == length) {
+                break;
+            }
+            char buffer[U8_MAX_LENGTH];
+            int32_t size = 0;
+            U8_APPEND_UNSAFE(buffer, size, fAlphabet[(key >> (LETTER_BITS * k)) & 0xff]);
+            pattern.append(buffer, size);
+        }
+        patterns.push_back(pattern);
+    });
+    sort(patterns.begin(), patterns.end());
+
+    ofstream out(filePath);
+    if (!out.is_open()) {
+        cerr << "could not open '" << filePath << "' for writing" << endl;
+        return FAILED;
+    }
+    out << "% Generated by hyphen_trainer from " << source << ", " << fWords.size() << " words\n";
+    out << "% levels (min length, max length, good weight, bad weight, threshold):\n";
+    for (const auto& level : fOptions.levels) {
+        out << "%   " << level.minLength << " " << level.maxLength << " " << level.good << " " << level.bad << " " <<
+            level.threshold << "\n";
+    }
+    out << "\\patterns{\n";
+    for (const auto& pattern : patterns) {
+        out << pattern << "\n";
+    }
+    out << "}\n";
+    cout << "Wrote " << patterns.size() << " patterns to " << filePath << endl;
+    return out.good() ? SUCCEED : FAILED;
+}
+
+// min,max,good,bad,threshold
+bool ParseLevel(const string& value, TrainerLevel& level)
+{
+    istringstream input(value);
+    char separator = 0;
+    input >> level.minLength >> separator >> level.maxLength >> separator >> level.good >> separator >> level.bad >>
+        separator >> level.threshold;
+    return !input.fail() && level.minLength >= 1 && level.minLength <= level.maxLength &&
+        level.maxLength <= MAX_PATTERN_LENGTH && level.good != 0;
+}
+
+constexpr int32_t ARG_NUM = 2;
+
+int32_t ParseOptions(int argc, char** argv, TrainerOptions& options)
+{
+    int32_t index = 1;
+    for (; index < argc && argv[index][0] == '-' && argv[index][1] == '-'; index++) {
+        string option = argv[index];
+        if (index + 1 >= argc) {
+            cout << "missing value for " << option << endl;
+            return FAILED;
+        }
+        string value = argv[++index];
+        TrainerLevel level;
+        if (option == "--threads") {
+            options.threads = stoul(value);
+        } else if (option == "--left-min") {
+            options.leftMin = stoul(value);
+        } else if (option == "--right-min") {
+            options.rightMin = stoul(value);
+        } else if (option == "--level" && ParseLevel(value, level)) {
+            options.levels.push_back(level);
+        } else {
+            cout << "invalid option: " << option << " " << value << endl;
+            return FAILED;
+        }
+    }
+    if (options.levels.empty()) {
+        options.levels = DEFAULT_LEVELS;
+    }
+    if (options.levels.size() > MAX_LEVEL || argc - index != ARG_NUM) {
+        return FAILED;
+    }
+    return index;
+}
+} // namespace
+} // namespace OHOS::Hyphenate
+
+int main(int argc, char** argv)
+{
+    OHOS::Hyphenate::TrainerOptions options;
+    int32_t index = OHOS::Hyphenate::ParseOptions(argc, argv, options);
+    if (index == FAILED) {
+        cout << "usage: './hyphen_trainer [--threads N] [--left-min N] [--right-min N] "
+                "[--level min,max,good,bad,threshold]... words.hyp.txt ./out/hyph-xx.tex'"
+             << endl;
+        return FAILED;
+    }
+    OHOS::Hyphenate::PatternTrainer trainer(options);
+    if (trainer.ReadWords(argv[index]) != SUCCEED || trainer.Train() != SUCCEED) {
+        return FAILED;
+    }
+    return trainer.WriteTex(argv[index + 1], argv[index]);
+}
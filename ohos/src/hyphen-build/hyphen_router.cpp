@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hyphen_router.h"
+
+#include <iostream>
+#include <set>
+#include <unicode/uscript.h>
+
+using namespace std;
+
+namespace OHOS::Hyphenate {
+constexpr size_t CODE_POINT_COUNT = 0x10000;
+
+namespace {
+// script of a single code, USCRIPT_COMMON for codes that do not decide the language
+UScriptCode ScriptOf(uint16_t code)
+{
+    UErrorCode status = U_ZERO_ERROR;
+    UScriptCode script = uscript_getScript(code, &status);
+    if (U_FAILURE(status) || script == USCRIPT_INHERITED || script == USCRIPT_UNKNOWN) {
+        return USCRIPT_COMMON;
+    }
+    return script;
+}
+} // namespace
+
+int32_t HyphenRouter::AddDictionary(std::shared_ptr<const HyphenDictionary> dictionary)
+{
+    if (dictionary == nullptr) {
+        return HYPHEN_NO_ROUTE;
+    }
+    Entry entry{dictionary, vector<bool>(CODE_POINT_COUNT, false)};
+    set<int32_t> scripts;
+    for (auto code : dictionary->GetCoverage()) {
+        entry.coverage[code] = true;
+        if (auto script = ScriptOf(code); script != USCRIPT_COMMON) {
+            scripts.insert(script);
+        }
+    }
+    int32_t index = static_cast<int32_t>(fEntries.size());
+    for (auto script : scripts) {
+        fScripts[script].push_back(index);
+    }
+    fEntries.push_back(std::move(entry));
+    return index;
+}
+
+bool HyphenRouter::Covers(const Entry& entry, const std::vector<uint16_t>& utf16Target) const
+{
+    for (auto code : utf16Target) {
+        if (!entry.coverage[code] && ScriptOf(code) != USCRIPT_COMMON) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int32_t HyphenRouter::Route(const std::vector<uint16_t>& utf16Target) const
+{
+    UScriptCode script = USCRIPT_COMMON;
+    for (auto code : utf16Target) {
+        if ((script = ScriptOf(code)) != USCRIPT_COMMON) {
+            break;
+        }
+    }
+    auto ite = fScripts.find(script);
+    if (ite == fScripts.cend()) {
+        return HYPHEN_NO_ROUTE;
+    }
+    for (auto index : ite->second) {
+        if (Covers(fEntries[index], utf16Target)) {
+            return static_cast<int32_t>(index);
+        }
+    }
+    return HYPHEN_NO_ROUTE;
+}
+
+int32_t HyphenRouter::HyphenateBatch(const std::vector<std::vector<uint16_t>>& utf16Targets,
+                                     std::vector<std::vector<uint8_t>>& results, std::vector<int32_t>* routes) const
+{
+    vector<vector<size_t>> groups(fEntries.size());
+    results.clear();
+    if (routes) {
+        routes->clear();
+    }
+    for (size_t i = 0; i < utf16Targets.size(); i++) {
+        results.emplace_back(utf16Targets[i].size(), 0);
+        int32_t route = Route(utf16Targets[i]);
+        if (route != HYPHEN_NO_ROUTE) {
+            groups[route].push_back(i);
+        }
+        if (routes) {
+            routes->push_back(route);
+        }
+    }
+
+    vector<vector<uint16_t>> targets;
+    vector<vector<uint8_t>> groupResults;
+    for (size_t index = 0; index < groups.size(); index++) {
+        const auto& group = groups[index];
+        if (group.empty()) {
+            continue;
+        }
+        targets.clear();
+        for (auto word : group) {
+            targets.push_back(utf16Targets[word]);
+        }
+        if (fEntries[index].dictionary->HyphenateBatch(targets, groupResults) != SUCCEED) {
+            cerr << "hyphenation failed for dictionary " << index << endl;
+            return FAILED;
+        }
+        for (size_t i = 0; i < group.size(); i++) {
+            results[group[i]] = std::move(groupResults[i]);
+        }
+    }
+    return SUCCEED;
+}
+} // namespace OHOS::Hyphenate
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HYPHENATE_ROUTER_H
+#define HYPHENATE_ROUTER_H
+
+#include "hyphen_pattern.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace OHOS::Hyphenate {
+constexpr int32_t HYPHEN_NO_ROUTE = -1;
+
+// Dispatches the words of mixed language text to the dictionaries covering them.
+// A word goes to the first added dictionary of its script that has entries for
+// all of its letters, punctuation and other script neutral codes are not required.
+class HyphenRouter {
+public:
+    // returns the index of the dictionary, dictionaries of the same script are tried in this order
+    int32_t AddDictionary(std::shared_ptr<const HyphenDictionary> dictionary);
+    size_t DictionaryCount() const
+    {
+        return fEntries.size();
+    }
+
+    // dictionary for a word in the form given by GetInputWord, HYPHEN_NO_ROUTE if none covers it
+    int32_t Route(const std::vector<uint16_t>& utf16Target) const;
+    // The words of each dictionary are hyphenated as one batch. Words without a dictionary
+    // are not looked up and get all zero levels, routes (if given) receives the dictionary per word.
+    int32_t HyphenateBatch(const std::vector<std::vector<uint16_t>>& utf16Targets,
+                           std::vector<std::vector<uint8_t>>& results, std::vector<int32_t>* routes = nullptr) const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const HyphenDictionary> dictionary;
+        std::vector<bool> coverage; // indexed by code point
+    };
+    bool Covers(const Entry& entry, const std::vector<uint16_t>& utf16Target) const;
+
+    std::vector<Entry> fEntries;
+    std::map<int32_t, std::vector<size_t>> fScripts; // UScriptCode to dictionaries
+};
+} // namespace OHOS::Hyphenate
+#endif
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hyphen_pattern.h"
+#include "hyphen_service.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <dirent.h>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+
+namespace OHOS::Hyphenate {
+// Requests arriving within the window are coalesced to a single batch
+constexpr auto BATCH_WINDOW = chrono::microseconds(200);
+constexpr size_t MAX_BATCH_REQUESTS = 64;
+constexpr int32_t LISTEN_BACKLOG = 64;
+
+struct ServiceConnection {
+    explicit ServiceConnection(int socketFd) : fd(socketFd) {}
+    ~ServiceConnection() { (void)close(fd); }
+    int fd;
+    mutex writeLock;
+};
+
+struct ServiceRequest {
+    shared_ptr<ServiceConnection> connection;
+    uint32_t id{0};
+    string language;
+    vector<vector<uint16_t>> words; // in reader input form
+};
+
+// Owns the mapped dictionaries and serves them to the connected clients.
+// Every connection has a reader thread queueing the requests, the workers
+// take whatever has been queued within the batch window and run one
+// HyphenateBatch per dictionary.
+class HyphenService {
+public:
+    int32_t LoadDictionaries(const string& directory);
+    int32_t Run(const string& socketPath, size_t workerCount);
+
+private:
+    void ServeConnection(shared_ptr<ServiceConnection> connection);
+    bool ReadRequest(const shared_ptr<ServiceConnection>& connection, ServiceRequest& request);
+    void Work();
+    void ProcessBatch(vector<ServiceRequest>& batch);
+    void SendResponse(ServiceRequest& request, int32_t status, const vector<vector<uint8_t>>* results);
+
+    map<string, shared_ptr<HyphenDictionary>> fDictionaries;
+    mutex fLock;
+    condition_variable fReady;
+    deque<ServiceRequest> fQueue;
+};
+
+int32_t HyphenService::LoadDictionaries(const string& directory)
+{
+    DIR* dir = opendir(directory.c_str());
+    if (dir == nullptr) {
+        cerr << "could not open '" << directory << "'" << endl;
+        return FAILED;
+    }
+    const string suffix = ".hpb";
+    HyphenOpenOptions options;
+    options.lockMetadata = true;
+    options.replicatePerNode = true;
+    while (dirent* entry = readdir(dir)) {
+        string name = entry->d_name;
+        if (name.size() <= suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+            continue;
+        }
+        auto dictionary = HyphenDictionary::Open((directory + "/" + name).c_str(), options);
+        if (dictionary == nullptr) {
+            cerr << "could not load '" << name << "'" << endl;
+            continue;
+        }
+        fDictionaries[name.substr(0, name.size() - suffix.size())] = dictionary;
+    }
+    (void)closedir(dir);
+    cout << "loaded " << fDictionaries.size() << " dictionaries from " << directory << endl;
+    return fDictionaries.empty() ? FAILED : SUCCEED;
+}
+
+bool HyphenService::ReadRequest(const shared_ptr<ServiceConnection>& connection, ServiceRequest& request)
+{
+    ServiceRequestHeader header;
+    if (!ReadFully(connection->fd, &header, sizeof(header))) {
+        return false;
+    }
+    if (header.magic != SERVICE_REQUEST_MAGIC || header.payloadSize > SERVICE_MAX_PAYLOAD ||
+        header.languageSize > SERVICE_MAX_LANGUAGE || header.languageSize > header.payloadSize) {
+        cerr << "malformed request, closing connection" << endl;
+        return false;
+    }
+    vector<uint8_t> payload(header.payloadSize);
+    if (!ReadFully(connection->fd, payload.data(), payload.size())) {
+        return false;
+    }
+    request.connection = connection;
+    request.id = header.id;
+    request.language.assign(reinterpret_cast<const char*>(payload.data()), header.languageSize);
+    size_t pos = header.languageSize;
+    for (uint16_t i = 0; i < header.wordCount; i++) {
+        uint16_t length = 0;
+        if (pos + sizeof(length) > payload.size()) {
+            return false;
+        }
+        memcpy(&length, payload.data() + pos, sizeof(length));
+        pos += sizeof(length);
+        if (pos + length * sizeof(uint16_t) > payload.size()) {
+            return false;
+        }
+        vector<uint16_t> word(length);
+        memcpy(word.data(), payload.data() + pos, length * sizeof(uint16_t));
+        pos += length * sizeof(uint16_t);
+        request.words.push_back(GetInputWord(word.data(), word.size()));
+    }
+    return true;
+}
+
+void HyphenService::ServeConnection(shared_ptr<ServiceConnection> connection)
+{
+    while (true) {
+        ServiceRequest request;
+        if (!ReadRequest(connection, request)) {
+            break;
+        }
+        {
+            lock_guard<mutex> lock(fLock);
+            fQueue.push_back(move(request));
+        }
+        fReady.notify_one();
+    }
+}
+
+void HyphenService::SendResponse(ServiceRequest& request, int32_t status, const vector<vector<uint8_t>>* results)
+{
+    vector<uint8_t> payload;
+    if (results) {
+        for (const auto& result : *results) {
+            // drop the levels of the '.' delimiters
+            uint16_t length = result.size() < HYPHEN_BASE_CODE_SHIFT ? 0 : result.size() - HYPHEN_BASE_CODE_SHIFT;
+            const auto* bytes = reinterpret_cast<const uint8_t*>(&length);
+            payload.insert(payload.end(), bytes, bytes + sizeof(length));
+            if (length != 0) {
+                payload.insert(payload.end(), result.begin() + 1, result.begin() + 1 + length);
+            }
+        }
+    }
+    ServiceResponseHeader header{SERVICE_RESPONSE_MAGIC, request.id, status,
+                                 static_cast<uint16_t>(results ? results->size() : 0), 0,
+                                 static_cast<uint32_t>(payload.size())};
+    lock_guard<mutex> lock(request.connection->writeLock);
+    if (!WriteFully(request.connection->fd, &header, sizeof(header)) ||
+        !WriteFully(request.connection->fd, payload.data(), payload.size())) {
+        cerr << "failed to send response " << request.id << endl;
+    }
+}
+
+void HyphenService::ProcessBatch(vector<ServiceRequest>& batch)
+{
+    map<string, vector<ServiceRequest*>> groups;
+    for (auto& request : batch) {
+        groups[request.language].push_back(&request);
+    }
+    for (auto& group : groups) {
+        auto dictionary = fDictionaries.find(group.first);
+        if (dictionary == fDictionaries.end()) {
+            for (auto request : group.second) {
+                SendResponse(*request, FAILED, nullptr);
+            }
+            continue;
+        }
+        // one pass over the dictionary for all the words of the group
+        vector<vector<uint16_t>> words;
+        for (auto request : group.second) {
+            for (auto& word : request->words) {
+                words.push_back(move(word));
+            }
+        }
+        vector<vector<uint8_t>> results;
+        dictionary->second->HyphenateBatch(words, results);
+        auto ite = results.begin();
+        for (auto request : group.second) {
+            vector<vector<uint8_t>> own(make_move_iterator(ite), make_move_iterator(ite + request->words.size()));
+            ite += request->words.size();
+            SendResponse(*request, SUCCEED, &own);
+        }
+    }
+}
+
+void HyphenService::Work()
+{
+    while (true) {
+        vector<ServiceRequest> batch;
+        {
+            unique_lock<mutex> lock(fLock);
+            fReady.wait(lock, [this]() { return !fQueue.empty(); });
+            fReady.wait_for(lock, BATCH_WINDOW, [this]() { return fQueue.size() >= MAX_BATCH_REQUESTS; });
+            while (!fQueue.empty() && batch.size() < MAX_BATCH_REQUESTS) {
+                batch.push_back(move(fQueue.front()));
+                fQueue.pop_front();
+            }
+        }
+        ProcessBatch(batch);
+    }
+}
+
+int32_t HyphenService::Run(const string& socketPath, size_t workerCount)
+{
+    int serverFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (serverFd < 0) {
+        cerr << "socket failed: " << errno << endl;
+        return FAILED;
+    }
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        cerr << "socket path is too long" << endl;
+        (void)close(serverFd);
+        return FAILED;
+    }
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    (void)unlink(socketPath.c_str());
+    if (bind(serverFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(serverFd, LISTEN_BACKLOG) != 0) {
+        cerr << "could not listen on '" << socketPath << "': " << errno << endl;
+        (void)close(serverFd);
+        return FAILED;
+    }
+    for (size_t i = 0; i < workerCount; i++) {
+        thread(&HyphenService::Work, this).detach();
+    }
+    cout << "serving on " << socketPath << " with " << workerCount << " workers" << endl;
+    while (true) {
+        int clientFd = accept(serverFd, nullptr, nullptr);
+        if (clientFd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            cerr << "accept failed: " << errno << endl;
+            break;
+        }
+        thread(&HyphenService::ServeConnection, this, make_shared<ServiceConnection>(clientFd)).detach();
+    }
+    (void)close(serverFd);
+    return FAILED;
+}
+} // namespace OHOS::Hyphenate
+
+namespace {
+constexpr int32_t ARG_NUM = 3;
+constexpr int32_t WORKERS_ARG = 3;
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc != ARG_NUM && argc != ARG_NUM + 1) {
+        cout << "usage: './hyphen_service /system/usr/ohos_hyphen_data /dev/unix/socket/hyphen [workers]'" << endl;
+        return FAILED;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    size_t workers = thread::hardware_concurrency();
+    if (argc > WORKERS_ARG) {
+        workers = static_cast<size_t>(strtoul(argv[WORKERS_ARG], nullptr, 0));
+    }
+
+    OHOS::Hyphenate::HyphenService service;
+    if (service.LoadDictionaries(argv[1]) != SUCCEED) {
+        return FAILED;
+    }
+    return service.Run(argv[2], workers == 0 ? 1 : workers);
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HYPHENATE_SERVICE_H
+#define HYPHENATE_SERVICE_H
+
+#include <cerrno>
+#include <cinttypes>
+#include <cstddef>
+#include <unistd.h>
+
+namespace OHOS::Hyphenate {
+constexpr uint32_t SERVICE_REQUEST_MAGIC = 0x51485948;  // "HYHQ"
+constexpr uint32_t SERVICE_RESPONSE_MAGIC = 0x52485948; // "HYHR"
+constexpr size_t SERVICE_MAX_PAYLOAD = 1 << 20;
+constexpr size_t SERVICE_MAX_LANGUAGE = 64;
+
+// Request: header, language name (e.g. "hyph-en-us") and for each word
+// its length in code units followed by the UTF-16 code units of the word
+struct ServiceRequestHeader {
+    uint32_t magic;
+    uint32_t id;
+    uint16_t languageSize;
+    uint16_t wordCount;
+    uint32_t payloadSize; // bytes following the header
+};
+
+// Response: header and for each word its length followed by one level per
+// code unit, level k belonging to the break before code unit k
+struct ServiceResponseHeader {
+    uint32_t magic;
+    uint32_t id;
+    int32_t status;
+    uint16_t wordCount;
+    uint16_t reserved;
+    uint32_t payloadSize; // bytes following the header
+};
+
+inline bool ReadFully(int fd, void* data, size_t size)
+{
+    auto bytes = static_cast<uint8_t*>(data);
+    while (size != 0) {
+        ssize_t count = read(fd, bytes, size);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        bytes += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+inline bool WriteFully(int fd, const void* data, size_t size)
+{
+    auto bytes = static_cast<const uint8_t*>(data);
+    while (size != 0) {
+        ssize_t count = write(fd, bytes, size);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        bytes += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+} // namespace OHOS::Hyphenate
+#endif
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hyphen_pattern.h"
+#include "hyphen_service.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+
+// Load generator for hyphen_service: every connection sends its requests one
+// after another and the latency of each round trip is collected
+namespace OHOS::Hyphenate {
+struct LoadConfig {
+    string socketPath;
+    string language;
+    size_t connections{1};
+    size_t requests{1};
+    vector<vector<uint16_t>> words;
+};
+
+static int Connect(const string& socketPath)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        (void)close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static vector<uint8_t> BuildRequest(const LoadConfig& config)
+{
+    vector<uint8_t> payload(config.language.begin(), config.language.end());
+    for (const auto& word : config.words) {
+        uint16_t length = static_cast<uint16_t>(word.size());
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&length);
+        payload.insert(payload.end(), bytes, bytes + sizeof(length));
+        bytes = reinterpret_cast<const uint8_t*>(word.data());
+        payload.insert(payload.end(), bytes, bytes + word.size() * sizeof(uint16_t));
+    }
+    ServiceRequestHeader header{SERVICE_REQUEST_MAGIC, 0, static_cast<uint16_t>(config.language.size()),
+                                static_cast<uint16_t>(config.words.size()), static_cast<uint32_t>(payload.size())};
+    vector<uint8_t> request(sizeof(header));
+    memcpy(request.data(), &header, sizeof(header));
+    request.insert(request.end(), payload.begin(), payload.end());
+    return request;
+}
+
+static void RunConnection(const LoadConfig& config, vector<double>& latencies, size_t& failures)
+{
+    int fd = Connect(config.socketPath);
+    if (fd < 0) {
+        failures += config.requests;
+        return;
+    }
+    vector<uint8_t> request = BuildRequest(config);
+    vector<uint8_t> payload;
+    for (size_t i = 0; i < config.requests; i++) {
+        auto header = reinterpret_cast<ServiceRequestHeader*>(request.data());
+        header->id = static_cast<uint32_t>(i);
+        auto start = chrono::steady_clock::now();
+        ServiceResponseHeader response;
+        if (!WriteFully(fd, request.data(), request.size()) || !ReadFully(fd, &response, sizeof(response))) {
+            failures += config.requests - i;
+            break;
+        }
+        payload.resize(response.payloadSize);
+        if (!ReadFully(fd, payload.data(), payload.size())) {
+            failures += config.requests - i;
+            break;
+        }
+        latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+        if (response.status != SUCCEED || response.id != i) {
+            failures++;
+        }
+    }
+    (void)close(fd);
+}
+
+static double Percentile(const vector<double>& sorted, double fraction)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()));
+    return sorted[index];
+}
+
+static void RunLoad(const LoadConfig& config)
+{
+    vector<vector<double>> latencies(config.connections);
+    vector<size_t> failures(config.connections, 0);
+    vector<thread> threads;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < config.connections; i++) {
+        threads.emplace_back(RunConnection, cref(config), ref(latencies[i]), ref(failures[i]));
+    }
+    for (auto& client : threads) {
+        client.join();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    vector<double> all;
+    size_t failed = 0;
+    for (size_t i = 0; i < config.connections; i++) {
+        all.insert(all.end(), latencies[i].begin(), latencies[i].end());
+        failed += failures[i];
+    }
+    sort(all.begin(), all.end());
+    cout << "requests: " << all.size() << " failed: " << failed << " words/request: " << config.words.size() << endl;
+    cout << "elapsed: " << seconds << " s" << endl;
+    cout << "throughput: " << (all.size() / seconds) << " requests/s, " <<
+        (all.size() * config.words.size() / seconds) << " words/s" << endl;
+    cout << "latency p50: " << Percentile(all, 0.5) << " us p99: " << Percentile(all, 0.99) << " us" << endl;
+}
+} // namespace OHOS::Hyphenate
+
+namespace {
+constexpr int32_t WORDS_ARG = 5;
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc <= WORDS_ARG) {
+        cout << "usage: './hyphen_service_client <socket> hyph-en-us <connections> <requests> <word> [<word>...]'"
+             << endl;
+        return FAILED;
+    }
+    OHOS::Hyphenate::LoadConfig config;
+    config.socketPath = argv[1];
+    config.language = argv[2];                              // 2: language
+    config.connections = strtoul(argv[3], nullptr, 0);      // 3: connections
+    config.requests = strtoul(argv[4], nullptr, 0);         // 4: requests per connection
+    for (int32_t i = WORDS_ARG; i < argc; i++) {
+        config.words.push_back(OHOS::Hyphenate::ConvertToUtf16(argv[i]));
+    }
+    OHOS::Hyphenate::RunLoad(config);
+    return SUCCEED;
+}
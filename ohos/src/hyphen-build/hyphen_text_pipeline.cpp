@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hyphen_text_pipeline.h"
+
+#include <iostream>
+#include <limits>
+#include <unicode/uchar.h>
+#include <unicode/utf16.h>
+
+using namespace std;
+
+namespace OHOS::Hyphenate {
+namespace {
+constexpr size_t MASK_BITS = 64;
+constexpr UChar32 RIGHT_SINGLE_QUOTE = 0x2019;
+
+// letters, marks and apostrophes only, ICU keeps "e.g." or "abc123" together as a letter word
+bool IsPlainWord(const uint16_t* word, size_t length)
+{
+    size_t i = 0;
+    while (i < length) {
+        UChar32 code = 0;
+        U16_NEXT(word, i, length, code);
+        if (!u_isalpha(code) && (U_GET_GC_MASK(code) & U_GC_M_MASK) == 0 && code != '\'' &&
+            code != RIGHT_SINGLE_QUOTE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HasUrlMarker(const uint16_t* text, size_t start, size_t end)
+{
+    for (size_t i = start; i < end; i++) {
+        if (text[i] == '@') {
+            return true;
+        }
+        if (text[i] == ':' && i + 2 < end && text[i + 1] == '/' && text[i + 2] == '/') {
+            return true;
+        }
+        if ((text[i] == 'w' || text[i] == 'W') && i + 3 < end && u_tolower(text[i + 1]) == 'w' &&
+            u_tolower(text[i + 2]) == 'w' && text[i + 3] == '.' && (i == start || !u_isalpha(text[i - 1]))) {
+            return true;
+        }
+    }
+    return false;
+}
+} // namespace
+
+HyphenTextPipeline::HyphenTextPipeline(std::shared_ptr<const HyphenDictionary> dictionary, const std::string& locale,
+                                       const HyphenTextOptions& options)
+    : fDictionary(std::move(dictionary)), fOptions(options)
+{
+    if (fOptions.minWordLength == 0) {
+        fOptions.minWordLength = max<size_t>(fOptions.breaks.leftMin + fOptions.breaks.rightMin, 1);
+    }
+    fOptions.batchSize = max<size_t>(fOptions.batchSize, 1);
+    UErrorCode status = U_ZERO_ERROR;
+    fIterator = ubrk_open(UBRK_WORD, locale.c_str(), nullptr, 0, &status);
+    if (U_FAILURE(status)) {
+        cerr << "could not open word break iterator: " << u_errorName(status) << endl;
+        fIterator = nullptr;
+    }
+}
+
+HyphenTextPipeline::~HyphenTextPipeline()
+{
+    if (fIterator != nullptr) {
+        ubrk_close(fIterator);
+    }
+}
+
+bool HyphenTextPipeline::InUrl(const uint16_t* text, size_t length, size_t position)
+{
+    if (position >= fRun.start && position < fRun.end) {
+        return fRun.url;
+    }
+    fRun.start = position;
+    while (fRun.start > 0 && !u_isUWhiteSpace(text[fRun.start - 1])) {
+        fRun.start--;
+    }
+    fRun.end = position;
+    while (fRun.end < length && !u_isUWhiteSpace(text[fRun.end])) {
+        fRun.end++;
+    }
+    fRun.url = HasUrlMarker(text, fRun.start, fRun.end);
+    return fRun.url;
+}
+
+int32_t HyphenTextPipeline::Flush(const uint16_t* text, std::vector<uint32_t>& breaks)
+{
+    if (fCount == 0) {
+        return SUCCEED;
+    }
+    // targets past fCount are storage kept from earlier batches
+    if (fDictionary->HyphenateMasks(fTargets.data(), fCount, fMasks, fOptions.breaks) != SUCCEED) {
+        return FAILED;
+    }
+    for (size_t i = 0; i < fCount; i++) {
+        size_t start = fStarts[i];
+        size_t length = fTargets[i].size() - HYPHEN_BASE_CODE_SHIFT;
+        const uint64_t* mask = fMasks.Mask(i);
+        for (size_t k = 1; k < length; k++) {
+            if (((mask[k / MASK_BITS] >> (k % MASK_BITS)) & 1) != 0 && !U16_IS_TRAIL(text[start + k])) {
+                breaks.push_back(static_cast<uint32_t>(start + k));
+            }
+        }
+    }
+    fCount = 0;
+    return SUCCEED;
+}
+
+int32_t HyphenTextPipeline::Hyphenate(const uint16_t* text, size_t length, std::vector<uint32_t>& breaks)
+{
+    breaks.clear();
+    if (fIterator == nullptr || fDictionary == nullptr ||
+        length > static_cast<size_t>(numeric_limits<int32_t>::max())) {
+        return FAILED;
+    }
+    UErrorCode status = U_ZERO_ERROR;
+    ubrk_setText(fIterator, reinterpret_cast<const UChar*>(text), static_cast<int32_t>(length), &status);
+    if (U_FAILURE(status)) {
+        cerr << "could not segment text: " << u_errorName(status) << endl;
+        return FAILED;
+    }
+    fRun = Run();
+    fCount = 0;
+    int32_t result = SUCCEED;
+    int32_t start = ubrk_first(fIterator);
+    for (int32_t end = ubrk_next(fIterator); end != UBRK_DONE; start = end, end = ubrk_next(fIterator)) {
+        // letter words only, this skips spaces, punctuation, numbers, kana and ideographs
+        int32_t type = ubrk_getRuleStatus(fIterator);
+        size_t size = static_cast<size_t>(end - start);
+        if (type < UBRK_WORD_LETTER || type >= UBRK_WORD_LETTER_LIMIT || size < fOptions.minWordLength ||
+            !IsPlainWord(text + start, size) || InUrl(text, length, start)) {
+            continue;
+        }
+        if (fCount == fTargets.size()) {
+            fTargets.emplace_back();
+        }
+        if (fCount == fStarts.size()) {
+            fStarts.emplace_back();
+        }
+        // the word is mapped straight from the text into the reused target
+        GetInputWord(text + start, size, fTargets[fCount]);
+        fStarts[fCount++] = static_cast<size_t>(start);
+        if (fCount == fOptions.batchSize && (result = Flush(text, breaks)) != SUCCEED) {
+            break;
+        }
+    }
+    if (result == SUCCEED) {
+        result = Flush(text, breaks);
+    }
+    fCount = 0;
+    // do not keep a pointer to the caller's text
+    ubrk_setText(fIterator, nullptr, 0, &status);
+    return result;
+}
+} // namespace OHOS::Hyphenate
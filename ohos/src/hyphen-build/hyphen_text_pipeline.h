@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HYPHENATE_TEXT_PIPELINE_H
+#define HYPHENATE_TEXT_PIPELINE_H
+
+#include "hyphen_pattern.h"
+
+#include <memory>
+#include <string>
+#include <unicode/ubrk.h>
+#include <vector>
+
+namespace OHOS::Hyphenate {
+struct HyphenTextOptions {
+    HyphenBreakOptions breaks;
+    // shorter words are not looked up, 0 uses leftMin + rightMin
+    size_t minWordLength{0};
+    // words hyphenated together, see HyphenDictionary::HyphenateMasks
+    size_t batchSize{64};
+};
+
+// Segments a text run with an ICU word BreakIterator and hyphenates its words in the
+// same pass. Numbers, words containing digits or '.', URLs, e-mail addresses and
+// words that are too short are skipped. A pipeline holds an ICU iterator and
+// scratch buffers, use one instance per thread.
+class HyphenTextPipeline {
+public:
+    // locale of the word break rules, e.g. "en_US", empty for the root rules
+    explicit HyphenTextPipeline(std::shared_ptr<const HyphenDictionary> dictionary, const std::string& locale = "",
+                                const HyphenTextOptions& options = {});
+    ~HyphenTextPipeline();
+    HyphenTextPipeline(const HyphenTextPipeline&) = delete;
+    HyphenTextPipeline& operator=(const HyphenTextPipeline&) = delete;
+
+    // offsets in code units of text a hyphen may be inserted before, ascending
+    int32_t Hyphenate(const uint16_t* text, size_t length, std::vector<uint32_t>& breaks);
+
+private:
+    // whitespace delimited run of the text and whether it looks like a URL or an address
+    struct Run {
+        size_t start{0};
+        size_t end{0};
+        bool url{false};
+    };
+    bool InUrl(const uint16_t* text, size_t length, size_t position);
+    int32_t Flush(const uint16_t* text, std::vector<uint32_t>& breaks);
+
+    std::shared_ptr<const HyphenDictionary> fDictionary;
+    HyphenTextOptions fOptions;
+    UBreakIterator* fIterator{nullptr};
+    Run fRun;
+    // current batch, the targets keep their storage between batches
+    size_t fCount{0};
+    std::vector<std::vector<uint16_t>> fTargets;
+    std::vector<size_t> fStarts;
+    HyphenBreakMasks fMasks;
+};
+} // namespace OHOS::Hyphenate
+#endif
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hyphen_user_dictionary.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+namespace OHOS::Hyphenate {
+namespace {
+bool HasDigit(const string& entry)
+{
+    return any_of(entry.cbegin(), entry.cend(), [](char c) { return isdigit(static_cast<unsigned char>(c)); });
+}
+
+// "ta-ble" to the reader form of ".table." with break levels, the same levels
+// hpb_transform produces for \hyphenation{} entries
+bool ParseException(const string& word, vector<uint16_t>& codes, vector<uint8_t>& levels)
+{
+    vector<uint16_t> letters;
+    levels.assign(1, 0);
+    uint8_t level = USER_NO_BREAK_LEVEL;
+    for (auto code : ConvertToUtf16(word)) {
+        if (code == '-') {
+            level = USER_BREAK_LEVEL;
+            continue;
+        }
+        letters.push_back(code);
+        levels.push_back(level);
+        level = USER_NO_BREAK_LEVEL;
+    }
+    if (letters.empty()) {
+        return false;
+    }
+    levels.push_back(0);
+    codes = GetInputWord(letters.data(), letters.size());
+    return true;
+}
+
+// ".ta1b" to codes "`tab" and levels 0 0 0 1
+bool ParsePattern(const string& pattern, UserPattern& parsed)
+{
+    vector<uint16_t> letters;
+    parsed.levels.clear();
+    bool addedLevel = false;
+    for (auto code : ConvertToUtf16(pattern)) {
+        if (code < 0x80 && isdigit(code)) {
+            parsed.levels.push_back(code - '0');
+            addedLevel = true;
+            continue;
+        }
+        if (!addedLevel) {
+            parsed.levels.push_back(0);
+        }
+        letters.push_back(code);
+        addedLevel = false;
+    }
+    if (letters.empty()) {
+        return false;
+    }
+    // map the codes as the reader does, without the word delimiters
+    auto mapped = GetInputWord(letters.data(), letters.size());
+    parsed.codes.assign(mapped.cbegin() + 1, mapped.cend() - 1);
+    return true;
+}
+} // namespace
+
+HyphenUserDictionary::HyphenUserDictionary(std::shared_ptr<const HyphenDictionary> base)
+    : fBase(std::move(base)), fSnapshot(new UserSnapshot())
+{
+}
+
+HyphenUserDictionary::~HyphenUserDictionary()
+{
+    delete fSnapshot.load();
+}
+
+HyphenUserDictionary::ReadGuard::ReadGuard(const HyphenUserDictionary& dictionary)
+{
+    // a writer may flip the epoch in between, count again in the new one then
+    while (true) {
+        uint32_t epoch = dictionary.fEpoch.load();
+        fReaders = &dictionary.fReaders[epoch & 1];
+        fReaders->fetch_add(1);
+        if (dictionary.fEpoch.load() == epoch) {
+            break;
+        }
+        fReaders->fetch_sub(1);
+    }
+    fSnapshot = dictionary.fSnapshot.load();
+}
+
+HyphenUserDictionary::ReadGuard::~ReadGuard()
+{
+    fReaders->fetch_sub(1);
+}
+
+// Readers entering after the flip see the new snapshot, the old one is freed
+// when the last reader of the previous epoch is done with it
+void HyphenUserDictionary::Publish(const UserSnapshot* snapshot)
+{
+    const UserSnapshot* previous = fSnapshot.exchange(snapshot);
+    uint32_t epoch = fEpoch.fetch_add(1);
+    while (fReaders[epoch & 1].load() != 0) {
+        this_thread::yield();
+    }
+    delete previous;
+}
+
+int32_t HyphenUserDictionary::Update(const std::vector<std::string>& entries, bool remove)
+{
+    lock_guard<mutex> lock(fWriteLock);
+    // only writers replace the snapshot
+    auto snapshot = make_unique<UserSnapshot>(*fSnapshot.load());
+    for (const auto& entry : entries) {
+        if (HasDigit(entry)) {
+            UserPattern pattern;
+            if (remove || !ParsePattern(entry, pattern)) {
+                cerr << "invalid user pattern: " << entry << endl;
+                return FAILED;
+            }
+            auto& patterns = snapshot->patterns[pattern.codes.back()];
+            auto ite = find_if(patterns.begin(), patterns.end(),
+                               [&pattern](const UserPattern& p) { return p.codes == pattern.codes; });
+            if (ite != patterns.end()) {
+                ite->levels = pattern.levels;
+            } else {
+                patterns.push_back(pattern);
+                snapshot->patternCount++;
+            }
+            continue;
+        }
+        vector<uint16_t> codes;
+        vector<uint8_t> levels;
+        if (!ParseException(entry, codes, levels)) {
+            cerr << "invalid user exception: " << entry << endl;
+            return FAILED;
+        }
+        if (remove) {
+            snapshot->exceptions.erase(codes);
+        } else {
+            snapshot->exceptions[codes] = levels;
+        }
+    }
+    // publish only complete updates, readers keep the snapshot they already hold
+    Publish(snapshot.release());
+    return SUCCEED;
+}
+
+int32_t HyphenUserDictionary::AddException(const std::string& word)
+{
+    if (HasDigit(word)) {
+        cerr << "invalid user exception: " << word << endl;
+        return FAILED;
+    }
+    return Update({word}, false);
+}
+
+int32_t HyphenUserDictionary::RemoveException(const std::string& word)
+{
+    return Update({word}, true);
+}
+
+int32_t HyphenUserDictionary::AddPattern(const std::string& pattern)
+{
+    if (!HasDigit(pattern)) {
+        cerr << "invalid user pattern: " << pattern << endl;
+        return FAILED;
+    }
+    return Update({pattern}, false);
+}
+
+int32_t HyphenUserDictionary::AddEntries(const std::vector<std::string>& entries)
+{
+    return Update(entries, false);
+}
+
+void HyphenUserDictionary::Clear()
+{
+    lock_guard<mutex> lock(fWriteLock);
+    Publish(new UserSnapshot());
+}
+
+size_t HyphenUserDictionary::ExceptionCount() const
+{
+    return ReadGuard(*this)->exceptions.size();
+}
+
+size_t HyphenUserDictionary::PatternCount() const
+{
+    return ReadGuard(*this)->patternCount;
+}
+
+void HyphenUserDictionary::Apply(const UserSnapshot& snapshot, const std::vector<uint16_t>& target,
+                                 std::vector<uint8_t>& result)
+{
+    if (auto ite = snapshot.exceptions.find(target); ite != snapshot.exceptions.cend()) {
+        result = ite->second;
+        return;
+    }
+    for (size_t end = 0; end < target.size() && !snapshot.patterns.empty(); end++) {
+        auto ite = snapshot.patterns.find(target[end]);
+        if (ite == snapshot.patterns.cend()) {
+            continue;
+        }
+        for (const auto& pattern : ite->second) {
+            size_t size = pattern.codes.size();
+            if (size > end + 1) {
+                continue;
+            }
+            size_t start = end + 1 - size;
+            if (!equal(pattern.codes.cbegin(), pattern.codes.cend(), target.cbegin() + start)) {
+                continue;
+            }
+            for (size_t i = 0; i < pattern.levels.size() && start + i < result.size(); i++) {
+                result[start + i] = max(result[start + i], pattern.levels[i]);
+            }
+        }
+    }
+}
+
+int32_t HyphenUserDictionary::Hyphenate(const std::vector<uint16_t>& utf16Target, std::vector<uint8_t>& result) const
+{
+    if (!fBase || fBase->Hyphenate(utf16Target, result) != SUCCEED) {
+        return FAILED;
+    }
+    Apply(*ReadGuard(*this), utf16Target, result);
+    return SUCCEED;
+}
+
+int32_t HyphenUserDictionary::HyphenateBatch(const std::vector<std::vector<uint16_t>>& utf16Targets,
+                                             std::vector<std::vector<uint8_t>>& results) const
+{
+    if (!fBase || fBase->HyphenateBatch(utf16Targets, results) != SUCCEED) {
+        return FAILED;
+    }
+    // the whole batch sees the same snapshot
+    ReadGuard snapshot(*this);
+    for (size_t i = 0; i < utf16Targets.size(); i++) {
+        Apply(*snapshot, utf16Targets[i], results[i]);
+    }
+    return SUCCEED;
+}
+} // namespace OHOS::Hyphenate
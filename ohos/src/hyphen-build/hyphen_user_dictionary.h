@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef HYPHENATE_USER_DICTIONARY_H
+#define HYPHENATE_USER_DICTIONARY_H
+
+#include "hyphen_pattern.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace OHOS::Hyphenate {
+constexpr uint8_t USER_BREAK_LEVEL = BREAK_FLAG - '0';
+constexpr uint8_t USER_NO_BREAK_LEVEL = NO_BREAK_FLAG - '0';
+
+struct UserPattern {
+    std::vector<uint16_t> codes;
+    std::vector<uint8_t> levels; // level k is applied before codes[k]
+};
+
+// Immutable state of an overlay, replaced as a whole on every update
+struct UserSnapshot {
+    // '.' delimited word in reader form and its levels, applied instead of the patterns
+    std::map<std::vector<uint16_t>, std::vector<uint8_t>> exceptions;
+    // patterns by their last code point
+    std::map<uint16_t, std::vector<UserPattern>> patterns;
+    size_t patternCount{0};
+};
+
+// Exception words and extra patterns layered over a read-only dictionary.
+// Updates copy the snapshot, modify the copy and publish it with a pointer swap.
+// Lookups only count themselves in the current epoch and never wait for writers,
+// a writer frees the replaced snapshot once the readers of its epoch are gone.
+// Several overlays (e.g. one per document) can share the same base dictionary.
+class HyphenUserDictionary {
+public:
+    explicit HyphenUserDictionary(std::shared_ptr<const HyphenDictionary> base);
+    ~HyphenUserDictionary();
+    HyphenUserDictionary(const HyphenUserDictionary&) = delete;
+    HyphenUserDictionary& operator=(const HyphenUserDictionary&) = delete;
+
+    // word in TeX \hyphenation{} form, e.g. "ta-ble"
+    int32_t AddException(const std::string& word);
+    int32_t RemoveException(const std::string& word);
+    // pattern in TeX \patterns{} form, e.g. ".ta1b"
+    int32_t AddPattern(const std::string& pattern);
+    // several entries with a single copy of the snapshot, lines holding a digit are patterns
+    int32_t AddEntries(const std::vector<std::string>& entries);
+    void Clear();
+    size_t ExceptionCount() const;
+    size_t PatternCount() const;
+
+    // Same contract as HyphenDictionary, targets in the form given by GetInputWord
+    int32_t Hyphenate(const std::vector<uint16_t>& utf16Target, std::vector<uint8_t>& result) const;
+    int32_t HyphenateBatch(const std::vector<std::vector<uint16_t>>& utf16Targets,
+                           std::vector<std::vector<uint8_t>>& results) const;
+
+private:
+    // Pins the current snapshot for as long as it lives
+    class ReadGuard {
+    public:
+        explicit ReadGuard(const HyphenUserDictionary& dictionary);
+        ~ReadGuard();
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        const UserSnapshot& operator*() const
+        {
+            return *fSnapshot;
+        }
+        const UserSnapshot* operator->() const
+        {
+            return fSnapshot;
+        }
+
+    private:
+        std::atomic<uint32_t>* fReaders{nullptr};
+        const UserSnapshot* fSnapshot{nullptr};
+    };
+
+    int32_t Update(const std::vector<std::string>& entries, bool remove);
+    void Publish(const UserSnapshot* snapshot);
+    static void Apply(const UserSnapshot& snapshot, const std::vector<uint16_t>& target,
+                      std::vector<uint8_t>& result);
+
+    std::shared_ptr<const HyphenDictionary> fBase;
+    std::atomic<const UserSnapshot*> fSnapshot;
+    // readers by the parity of the epoch they entered in
+    std::atomic<uint32_t> fEpoch{0};
+    mutable std::atomic<uint32_t> fReaders[2] = {};
+    std::mutex fWriteLock;
+};
+} // namespace OHOS::Hyphenate
+#endif
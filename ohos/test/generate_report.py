@@ -14,7 +14,6 @@
 # limitations under the License.
 import os
 import subprocess
-import re
 import shutil
 import json
 import sys
@@ -27,39 +26,22 @@ def run_command(command):
     return result.stdout, result.returncode
 
 
-def parse_log(log, tex_file, word, match_log_path, unmatch_log_path):
-    result_size_pattern = re.compile(r'result size: (\d+) while expecting (\d+)')
-    key_value_pattern = re.compile(r'([0-9a-fA-F]+): (\d+)')
-
-    lines = log.split('\n')
-    success = False
-    for i, line in enumerate(lines):
-        match = result_size_pattern.match(line)
-        if match:
-            result_size = int(match.group(1))
-            expecting_size = int(match.group(2))
-            if result_size == expecting_size:
-
-                index = 0
-                result_str = ""
-                for j in range(i + 1, i + 1 + result_size):
-                    key_value_match = key_value_pattern.match(lines[j])
-                    if key_value_match:
-                        value = int(key_value_match.group(2))
-                        if value % 2 == 1:
-                            success = True
-                            result_str += f"{index}:{value} "
-
-                        index += 1
-                if not success:
-                    with os.fdopen(os.open(unmatch_log_path, os.O_RDWR | os.O_CREAT, stat.S_IWUSR | stat.S_IRUSR),
-                                   'a') as unmatch_log:
-                        unmatch_log.write(f"{tex_file} {word}\n")
-                else:
-                    with os.fdopen(os.open(match_log_path, os.O_RDWR | os.O_CREAT, stat.S_IWUSR | stat.S_IRUSR),
-                                   'a') as match_log:
-                        match_log.write(f"{tex_file} {word} {result_str}\n")
-                break
+def write_logs(report_path, tex_names, match_log_path, unmatch_log_path):
+    with os.fdopen(os.open(report_path, os.O_RDONLY, stat.S_IWUSR | stat.S_IRUSR), 'r') as report_file:
+        report = json.load(report_file)
+
+    for language in report['languages']:
+        tex_filename = tex_names.get(language['language'], language['language'])
+        for result in language['results']:
+            # levels holds the odd levels as "index:value", empty when the word has no break
+            if result['levels']:
+                with os.fdopen(os.open(match_log_path, os.O_RDWR | os.O_CREAT | os.O_APPEND,
+                                       stat.S_IWUSR | stat.S_IRUSR), 'a') as match_log:
+                    match_log.write(f"{tex_filename} {result['word']} {result['levels']} \n")
+            else:
+                with os.fdopen(os.open(unmatch_log_path, os.O_RDWR | os.O_CREAT | os.O_APPEND,
+                                       stat.S_IWUSR | stat.S_IRUSR), 'a') as unmatch_log:
+                    unmatch_log.write(f"{tex_filename} {result['word']}\n")
 
 
 def main(config_file_name):
@@ -87,11 +69,13 @@ def main(config_file_name):
     match_log_path = os.path.join(report_subdir, 'match.log')
     unmatch_log_path = os.path.join(report_subdir, 'unmatch.log')
 
+    list_dir = os.path.join(out_dir, 'lists')
+    os.makedirs(list_dir)
+    word_lists = []
+    tex_names = {}
     for tex_file in tex_files:
         tex_filename = tex_file['filename']
         words = tex_file['words']
-        hpb_filename = f"{os.path.splitext(tex_filename)[0]}.hpb"
-        hpb_filepath = os.path.join(out_dir, hpb_filename)
 
         # Step 1: Run the transform command
         transform_command = ["./transform", os.path.join(file_path, tex_filename), out_dir]
@@ -100,18 +84,25 @@ def main(config_file_name):
         if returncode != 0:
             print(f"Transform command failed for {tex_filename}. Skipping to next file.")
             continue
+        if not words:
+            continue
 
-        for word in words:
-            # Step 2: Run the reader command
-            reader_command = ["./reader", hpb_filepath, word]
-            print(f"Running reader command for {word}...")
-            log_output, _ = run_command(reader_command)
-            print("Reader command output:")
-            print(log_output)
-
-            # Step 3: Parse the log output
-            print("Parsing log output...")
-            parse_log(log_output, tex_filename, word, match_log_path, unmatch_log_path)
+        # Step 2: Collect the words, one list per language
+        language = os.path.splitext(tex_filename)[0]
+        list_path = os.path.join(list_dir, f"{language}.words.txt")
+        with os.fdopen(os.open(list_path, os.O_WRONLY | os.O_CREAT, stat.S_IWUSR | stat.S_IRUSR), 'w') as word_list:
+            word_list.write('\n'.join(words) + '\n')
+        word_lists.append(list_path)
+        tex_names[language] = tex_filename
+
+    # Step 3: Hyphenate all the lists with a single run, every dictionary is loaded once
+    report_path = os.path.join(report_subdir, 'report.json')
+    regression_command = ["./hyphen_regression", out_dir, report_path] + word_lists
+    print("Running regression command...")
+    log_output, _ = run_command(regression_command)
+    print(log_output)
+    if os.path.exists(report_path):
+        write_logs(report_path, tex_names, match_log_path, unmatch_log_path)
 
     # Step 4: Delete the out_hpb directory
     print("Deleting out_hpb directory...")
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Compares the matchers compiled by hpb_transform --emit-cpp with the hpb reader:
+// both hyphenate the same word lists, any difference in the levels is reported
+// together with the time each of them took.
+//
+// usage: hyphen_codegen_benchmark [--rounds N] <hpb_dir> <list>...
+// A list is named <language>.<suffix> and holds one word per line, '-' marks are ignored.
+
+#include "hyphen_generated.h"
+#include "hyphen_pattern.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace OHOS::Hyphenate;
+
+namespace {
+constexpr int32_t MIN_ARG_NUM = 3;
+
+int32_t ReadTargets(const string& filePath, vector<vector<uint16_t>>& targets)
+{
+    ifstream input(filePath);
+    if (!input.is_open()) {
+        cerr << "could not open " << filePath << endl;
+        return FAILED;
+    }
+    for (string line; getline(input, line);) {
+        if (line.empty() || line[0] == '%') {
+            continue;
+        }
+        vector<uint16_t> word;
+        for (auto code : ConvertToUtf16(line)) {
+            if (code != '-' && code != '\r' && code != ' ' && code != '\t') {
+                word.push_back(code);
+            }
+        }
+        if (!word.empty()) {
+            targets.push_back(GetInputWord(word.data(), word.size()));
+        }
+    }
+    return SUCCEED;
+}
+
+// returns the amount of words with different levels
+size_t RunLanguage(const string& hpbDir, const string& language, const vector<vector<uint16_t>>& targets,
+                   size_t rounds)
+{
+    using Clock = chrono::steady_clock;
+    HyphenGeneratedMatcher matcher = FindGeneratedMatcher(language);
+    auto dictionary = HyphenDictionary::Open((hpbDir + "/" + language + ".hpb").c_str());
+    if (matcher == nullptr || dictionary == nullptr) {
+        cerr << language << ": " << (matcher == nullptr ? "not compiled in" : "no dictionary") << endl;
+        return targets.size();
+    }
+
+    vector<vector<uint8_t>> readerLevels;
+    auto start = Clock::now();
+    for (size_t round = 0; round < rounds; round++) {
+        (void)dictionary->HyphenateBatch(targets, readerLevels);
+    }
+    double readerUs = chrono::duration<double, micro>(Clock::now() - start).count();
+
+    vector<vector<uint8_t>> generatedLevels(targets.size());
+    start = Clock::now();
+    for (size_t round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < targets.size(); i++) {
+            HyphenateGenerated(matcher, targets[i], generatedLevels[i]);
+        }
+    }
+    double generatedUs = chrono::duration<double, micro>(Clock::now() - start).count();
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < targets.size(); i++) {
+        mismatches += readerLevels[i] != generatedLevels[i] ? 1 : 0;
+    }
+    cout << language << ": " << targets.size() << " words x " << rounds << ", reader " << readerUs << " us, generated " <<
+        generatedUs << " us, " << mismatches << " mismatches" << endl;
+    return mismatches;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int32_t index = 1;
+    size_t rounds = 1;
+    if (argc > MIN_ARG_NUM && string(argv[index]) == "--rounds") {
+        rounds = static_cast<size_t>(stoul(argv[index + 1]));
+        index += MIN_ARG_NUM - 1;
+    }
+    if (argc - index < MIN_ARG_NUM - 1) {
+        cout << "usage: './hyphen_codegen_benchmark [--rounds N] <hpb_dir> <list>...'" << endl;
+        return FAILED;
+    }
+    const string hpbDir = argv[index];
+    size_t mismatches = 0;
+    for (int32_t i = index + 1; i < argc; i++) {
+        string fileName = argv[i];
+        fileName = fileName.substr(fileName.find_last_of("/\\") + 1);
+        vector<vector<uint16_t>> targets;
+        if (ReadTargets(argv[i], targets) != SUCCEED) {
+            return FAILED;
+        }
+        mismatches += RunLanguage(hpbDir, fileName.substr(0, fileName.find('.')), targets, rounds);
+    }
+    return mismatches == 0 ? SUCCEED : FAILED;
+}
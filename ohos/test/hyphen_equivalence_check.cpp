@@ -0,0 +1,390 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks that a .hpb reproduces the .tex it was built from. The dictionary is decompiled
+// into its patterns, which are compared with the patterns and exceptions of the source.
+// Then every substring of the source patterns is hyphenated by the dictionary and by a
+// reference matcher over the source, spread over all cores, and the levels are compared.
+//
+// usage: hyphen_equivalence_check [--threads N] [--examples N] [--dump out.tex] <hpb> <tex>
+// --dump writes the decompiled patterns as a .tex file. Returns FAILED if anything differs.
+
+#include "hyphen_pattern.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unicode/utf8.h>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace OHOS::Hyphenate;
+
+namespace {
+constexpr int32_t MIN_ARG_NUM = 3;
+constexpr size_t WORDS_PER_BATCH = 256;
+constexpr size_t DEFAULT_EXAMPLES = 10;
+
+using PatternMap = map<vector<uint16_t>, vector<uint8_t>>;
+
+struct SourcePatterns {
+    PatternMap patterns;
+    size_t duplicates{0};
+    size_t conflicting{0};
+};
+
+// reader form of a pattern code, as hpb_transform stores it
+uint16_t MapPatternCode(uint16_t code)
+{
+    if (code == '.') {
+        return '`';
+    } else if (code == '-') {
+        return '_';
+    } else if (code == '\'') {
+        return '^';
+    }
+    return code;
+}
+
+string PrintCodes(const vector<uint16_t>& codes, const vector<uint8_t>* levels = nullptr)
+{
+    string text;
+    for (size_t i = 0; i <= codes.size(); i++) {
+        if (levels != nullptr && i < levels->size() && (*levels)[i] != 0) {
+            text += to_string((*levels)[i]);
+        }
+        if (i == codes.size()) {
+            break;
+        }
+        UChar32 code = codes[i] == '`' ? '.' : codes[i] == '^' ? '\'' : codes[i] == '_' ? '-' : codes[i];
+        char buffer[U8_MAX_LENGTH];
+        int32_t length = 0;
+        U8_APPEND_UNSAFE(buffer, length, code);
+        text.append(buffer, length);
+    }
+    return text;
+}
+
+void TrimLevels(vector<uint8_t>& levels)
+{
+    while (!levels.empty() && levels.back() == 0) {
+        levels.pop_back();
+    }
+}
+
+void AddPattern(const vector<uint16_t>& pattern, SourcePatterns& source)
+{
+    vector<uint16_t> codes;
+    vector<uint8_t> levels;
+    bool addedLevel = false;
+    for (auto code : pattern) {
+        if (code >= '0' && code <= '9') {
+            levels.push_back(code - '0');
+            addedLevel = true;
+            continue;
+        }
+        if (!addedLevel) {
+            levels.push_back(0);
+        }
+        codes.push_back(MapPatternCode(code));
+        addedLevel = false;
+    }
+    TrimLevels(levels);
+    // a pattern without levels changes nothing and is not stored
+    if (codes.empty() || levels.empty()) {
+        return;
+    }
+    auto ite = source.patterns.find(codes);
+    if (ite != source.patterns.end()) {
+        source.duplicates++;
+        source.conflicting += ite->second != levels ? 1 : 0;
+    }
+    source.patterns[codes] = levels;
+}
+
+// exceptions are compiled to whole word patterns, see ProcessWord of hpb_transform
+void AddException(const vector<uint16_t>& word, SourcePatterns& source)
+{
+    vector<uint16_t> pattern = {'.'};
+    bool addedBreak = false;
+    for (auto code : word) {
+        if (code == '-') {
+            pattern.push_back(BREAK_FLAG);
+            addedBreak = true;
+            continue;
+        }
+        if (!addedBreak) {
+            pattern.push_back(NO_BREAK_FLAG);
+        }
+        pattern.push_back(code);
+        addedBreak = false;
+    }
+    pattern.push_back('.');
+    AddPattern(pattern, source);
+}
+
+// Content of the \patterns{} and \hyphenation{} groups, comments removed
+int32_t ReadSource(const string& filePath, SourcePatterns& source)
+{
+    ifstream input(filePath);
+    if (!input.is_open()) {
+        cerr << "could not open " << filePath << endl;
+        return FAILED;
+    }
+    string section;
+    for (string line; getline(input, line);) {
+        line = line.substr(0, line.find('%'));
+        size_t i = 0;
+        while (i < line.size()) {
+            if (isspace(static_cast<unsigned char>(line[i]))) {
+                i++;
+            } else if (line[i] == '\\') {
+                size_t end = i + 1;
+                while (end < line.size() && isalpha(static_cast<unsigned char>(line[end]))) {
+                    end++;
+                }
+                string name = line.substr(i + 1, end - i - 1);
+                section = name == "patterns" || name == "hyphenation" ? name : "";
+                i = end;
+            } else if (line[i] == '{') {
+                i++;
+            } else if (line[i] == '}') {
+                section.clear();
+                i++;
+            } else {
+                size_t end = i;
+                while (end < line.size() && !isspace(static_cast<unsigned char>(line[end])) && line[end] != '}') {
+                    end++;
+                }
+                auto token = ConvertToUtf16(line.substr(i, end - i));
+                if (section == "patterns") {
+                    AddPattern(token, source);
+                } else if (section == "hyphenation") {
+                    AddException(token, source);
+                }
+                i = end;
+            }
+        }
+    }
+    return SUCCEED;
+}
+
+PatternMap Decompile(const HyphenDictionary& dictionary)
+{
+    vector<HyphenStoredPattern> stored;
+    (void)dictionary.Decompile(stored);
+    PatternMap decompiled;
+    for (auto& pattern : stored) {
+        TrimLevels(pattern.levels);
+        if (!pattern.levels.empty()) {
+            decompiled[pattern.codes] = pattern.levels;
+        }
+    }
+    return decompiled;
+}
+
+// the decompiled patterns as a .tex file hpb_transform accepts
+int32_t WriteDecompiled(const string& filePath, const PatternMap& decompiled)
+{
+    ofstream out(filePath);
+    if (!out.is_open()) {
+        cerr << "could not open " << filePath << endl;
+        return FAILED;
+    }
+    out << "\\patterns{\n";
+    for (const auto& pattern : decompiled) {
+        out << PrintCodes(pattern.first, &pattern.second) << "\n";
+    }
+    out << "}\n";
+    return out.good() ? SUCCEED : FAILED;
+}
+
+size_t CompareDecompiled(const PatternMap& decompiled, const SourcePatterns& source, size_t examples)
+{
+    size_t missing = 0;
+    size_t changed = 0;
+    size_t extra = 0;
+    for (const auto& pattern : source.patterns) {
+        auto ite = decompiled.find(pattern.first);
+        bool differs = ite == decompiled.end() || ite->second != pattern.second;
+        if (differs && missing + changed < examples) {
+            cout << "  source " << PrintCodes(pattern.first, &pattern.second) << " stored " <<
+                (ite == decompiled.end() ? "-" : PrintCodes(ite->first, &ite->second)) << endl;
+        }
+        if (ite == decompiled.end()) {
+            missing++;
+        } else if (differs) {
+            changed++;
+        }
+    }
+    for (const auto& pattern : decompiled) {
+        if (source.patterns.find(pattern.first) == source.patterns.end()) {
+            if (extra++ < examples) {
+                cout << "  stored only " << PrintCodes(pattern.first, &pattern.second) << endl;
+            }
+        }
+    }
+    cout << "decompiled " << decompiled.size() << " patterns, source " << source.patterns.size() << " (" <<
+        source.duplicates << " duplicates, " << source.conflicting << " conflicting): " << missing << " missing, " <<
+        changed << " changed, " << extra << " extra" << endl;
+    return missing + changed + extra;
+}
+
+// TeX semantics over the source patterns
+class ReferenceMatcher {
+public:
+    explicit ReferenceMatcher(const PatternMap& patterns)
+    {
+        for (const auto& pattern : patterns) {
+            fPatterns.emplace(u16string(pattern.first.begin(), pattern.first.end()), &pattern.second);
+            fMaxLength = max(fMaxLength, pattern.first.size());
+        }
+    }
+
+    void Hyphenate(const vector<uint16_t>& target, vector<uint8_t>& result) const
+    {
+        result.assign(target.size(), 0);
+        u16string key;
+        for (size_t start = 0; start < target.size(); start++) {
+            key.clear();
+            for (size_t end = start; end < target.size() && end - start < fMaxLength; end++) {
+                key.push_back(target[end]);
+                auto ite = fPatterns.find(key);
+                // like the reader, position zero is never a pattern end
+                if (end == 0 || ite == fPatterns.end()) {
+                    continue;
+                }
+                const auto& levels = *ite->second;
+                for (size_t k = 0; k < levels.size() && start + k < result.size(); k++) {
+                    result[start + k] = max(result[start + k], levels[k]);
+                }
+            }
+        }
+    }
+
+private:
+    unordered_map<u16string, const vector<uint8_t>*> fPatterns;
+    size_t fMaxLength{0};
+};
+
+// every substring of the letters of every pattern, in reader form with the delimiters
+vector<vector<uint16_t>> CollectTargets(const PatternMap& patterns)
+{
+    const uint16_t delimiter = '`';
+    set<vector<uint16_t>> words;
+    for (const auto& pattern : patterns) {
+        auto begin = pattern.first.begin();
+        auto end = pattern.first.end();
+        begin += *begin == delimiter ? 1 : 0;
+        end -= begin != end && *(end - 1) == delimiter ? 1 : 0;
+        for (auto first = begin; first < end; first++) {
+            for (auto last = first + 1; last <= end; last++) {
+                vector<uint16_t> word = {delimiter};
+                word.insert(word.end(), first, last);
+                word.push_back(delimiter);
+                words.insert(move(word));
+            }
+        }
+    }
+    return vector<vector<uint16_t>>(words.begin(), words.end());
+}
+
+size_t CompareLookups(const HyphenDictionary& dictionary, const SourcePatterns& source, size_t threads,
+                      size_t examples)
+{
+    const auto targets = CollectTargets(source.patterns);
+    const ReferenceMatcher reference(source.patterns);
+    atomic<size_t> next{0};
+    atomic<size_t> mismatches{0};
+    mutex printLock;
+    auto run = [&]() {
+        vector<vector<uint16_t>> batch;
+        vector<vector<uint8_t>> results;
+        vector<uint8_t> expected;
+        for (size_t begin = next.fetch_add(WORDS_PER_BATCH); begin < targets.size();
+             begin = next.fetch_add(WORDS_PER_BATCH)) {
+            batch.assign(targets.begin() + begin, targets.begin() + min(begin + WORDS_PER_BATCH, targets.size()));
+            (void)dictionary.HyphenateBatch(batch, results);
+            for (size_t i = 0; i < batch.size(); i++) {
+                reference.Hyphenate(batch[i], expected);
+                if (results[i] == expected) {
+                    continue;
+                }
+                if (mismatches++ < examples) {
+                    lock_guard<mutex> lock(printLock);
+                    cout << "  " << PrintCodes(batch[i]) << ": reader " << PrintCodes(batch[i], &results[i]) <<
+                        " reference " << PrintCodes(batch[i], &expected) << endl;
+                }
+            }
+        }
+    };
+    vector<thread> workers;
+    for (size_t i = 1; i < threads; i++) {
+        workers.emplace_back(run);
+    }
+    run();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    cout << "looked up " << targets.size() << " substrings on " << threads << " threads: " << mismatches <<
+        " mismatches" << endl;
+    return mismatches;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int32_t index = 1;
+    size_t threads = max<size_t>(thread::hardware_concurrency(), 1);
+    size_t examples = DEFAULT_EXAMPLES;
+    string dumpPath;
+    for (; index + 1 < argc && argv[index][0] == '-' && argv[index][1] == '-'; index += MIN_ARG_NUM - 1) {
+        string option = argv[index];
+        if (option == "--threads") {
+            threads = max<size_t>(stoul(argv[index + 1]), 1);
+        } else if (option == "--examples") {
+            examples = stoul(argv[index + 1]);
+        } else if (option == "--dump") {
+            dumpPath = argv[index + 1];
+        } else {
+            break;
+        }
+    }
+    if (argc - index != MIN_ARG_NUM - 1) {
+        cout << "usage: './hyphen_equivalence_check [--threads N] [--examples N] [--dump out.tex] "
+                "hyph-en-us.hpb hyph-en-us.tex'" << endl;
+        return FAILED;
+    }
+    auto dictionary = HyphenDictionary::Open(argv[index]);
+    SourcePatterns source;
+    if (dictionary == nullptr || ReadSource(argv[index + 1], source) != SUCCEED) {
+        return FAILED;
+    }
+    PatternMap decompiled = Decompile(*dictionary);
+    if (!dumpPath.empty() && WriteDecompiled(dumpPath, decompiled) != SUCCEED) {
+        return FAILED;
+    }
+    size_t differences = CompareDecompiled(decompiled, source, examples);
+    differences += CompareLookups(*dictionary, source, threads, examples);
+    return differences == 0 ? SUCCEED : FAILED;
+}
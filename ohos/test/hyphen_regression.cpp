@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2024 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Regression runner: loads every dictionary once, hyphenates whole word lists in
+// batches and compares the breaks with golden hyphenations, the results are
+// written as a json report.
+//
+// usage: hyphen_regression [--left N] [--right N] <hpb_dir> <report.json> <list>...
+// A list is named <language>.<suffix> (e.g. hyph-en-us.hyp.txt) and holds one word
+// per line, words containing '-' are golden hyphenations, '%' starts a comment.
+
+#include "hyphen_pattern.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unicode/utf16.h>
+#include <unicode/utf8.h>
+#include <vector>
+
+using namespace std;
+using namespace OHOS::Hyphenate;
+
+namespace {
+constexpr size_t MASK_BITS = 64;
+constexpr int32_t MIN_ARG_NUM = 4;
+
+struct TestWord {
+    string word;            // without break marks
+    vector<uint16_t> utf16; // without break marks
+    vector<uint64_t> golden;
+    bool hasGolden{false};
+};
+
+struct LanguageReport {
+    string language;
+    size_t words{0};
+    size_t checked{0};
+    size_t passed{0};
+    size_t missing{0}; // golden breaks not found
+    size_t extra{0};   // breaks not in the golden data
+    double loadUs{0};
+    double hyphenateUs{0};
+    bool loaded{false};
+    vector<string> entries; // json objects of the words
+};
+
+string EscapeJson(const string& text)
+{
+    string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buffer[8]; // 8: room for \u00XX
+            (void)snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            escaped += buffer;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// word with '-' before every code unit whose bit is set
+string Hyphenated(const vector<uint16_t>& utf16, const uint64_t* mask)
+{
+    string text;
+    size_t i = 0;
+    while (i < utf16.size()) {
+        if (i != 0 && ((mask[i / MASK_BITS] >> (i % MASK_BITS)) & 1) != 0) {
+            text += '-';
+        }
+        UChar32 c = 0;
+        U16_NEXT(utf16.data(), i, utf16.size(), c);
+        uint8_t buffer[U8_MAX_LENGTH];
+        int32_t length = 0;
+        U8_APPEND_UNSAFE(buffer, length, c);
+        text.append(reinterpret_cast<const char*>(buffer), length);
+    }
+    return text;
+}
+
+bool ParseWord(const string& line, TestWord& word)
+{
+    vector<uint16_t> utf16 = ConvertToUtf16(line);
+    for (auto code : utf16) {
+        if (code == '-') {
+            word.hasGolden = true;
+            continue;
+        }
+        word.utf16.push_back(code);
+    }
+    if (word.utf16.empty()) {
+        return false;
+    }
+    word.golden.assign((word.utf16.size() + MASK_BITS - 1) / MASK_BITS, 0);
+    size_t position = 0;
+    for (auto code : utf16) {
+        if (code == '-') {
+            word.golden[position / MASK_BITS] |= 1ULL << (position % MASK_BITS);
+        } else {
+            position++;
+        }
+    }
+    word.word.clear();
+    for (char c : line) {
+        if (c != '-') {
+            word.word += c;
+        }
+    }
+    return true;
+}
+
+int32_t ReadList(const string& filePath, vector<TestWord>& words)
+{
+    ifstream input(filePath);
+    if (!input.is_open()) {
+        cerr << "could not open " << filePath << endl;
+        return FAILED;
+    }
+    for (string line; getline(input, line);) {
+        size_t end = line.find_last_not_of(" \t\r");
+        if (end == string::npos || line[0] == '%') {
+            continue;
+        }
+        TestWord word;
+        if (ParseWord(line.substr(0, end + 1), word)) {
+            words.push_back(std::move(word));
+        }
+    }
+    return SUCCEED;
+}
+
+void CompareWord(const TestWord& word, const HyphenBreakMasks& masks, size_t index,
+                 const vector<uint8_t>& levels, LanguageReport& report)
+{
+    const uint64_t* mask = masks.Mask(index);
+    size_t missing = 0;
+    size_t extra = 0;
+    for (size_t i = 0; i < word.golden.size() && word.hasGolden; i++) {
+        missing += static_cast<size_t>(__builtin_popcountll(word.golden[i] & ~mask[i]));
+        extra += static_cast<size_t>(__builtin_popcountll(mask[i] & ~word.golden[i]));
+    }
+    // odd levels as "index:level", index counting the leading '.', as the old match.log
+    string odd;
+    for (size_t i = 0; i < levels.size(); i++) {
+        if ((levels[i] & 1) != 0) {
+            odd += (odd.empty() ? "" : " ") + to_string(i) + ":" + to_string(levels[i]);
+        }
+    }
+    ostringstream entry;
+    entry << "{\"word\": \"" << EscapeJson(word.word) << "\", \"hyphenated\": \"" <<
+        EscapeJson(Hyphenated(word.utf16, mask)) << "\", \"levels\": \"" << odd << "\"";
+    if (word.hasGolden) {
+        report.checked++;
+        report.missing += missing;
+        report.extra += extra;
+        bool passed = missing == 0 && extra == 0;
+        report.passed += passed ? 1 : 0;
+        entry << ", \"expected\": \"" << EscapeJson(Hyphenated(word.utf16, word.golden.data())) <<
+            "\", \"passed\": " << (passed ? "true" : "false");
+    }
+    entry << "}";
+    report.entries.push_back(entry.str());
+}
+
+void RunLanguage(const string& hpbDir, const vector<TestWord>& words, const HyphenBreakOptions& options,
+                 LanguageReport& report)
+{
+    using Clock = chrono::steady_clock;
+    report.words = words.size();
+    auto start = Clock::now();
+    auto dictionary = HyphenDictionary::Open((hpbDir + "/" + report.language + ".hpb").c_str());
+    auto loaded = Clock::now();
+    report.loadUs = chrono::duration<double, micro>(loaded - start).count();
+    if (dictionary == nullptr) {
+        cerr << "could not open dictionary of " << report.language << endl;
+        return;
+    }
+    report.loaded = true;
+
+    vector<vector<uint16_t>> targets;
+    targets.reserve(words.size());
+    for (const auto& word : words) {
+        targets.push_back(GetInputWord(word.utf16.data(), word.utf16.size()));
+    }
+    vector<vector<uint8_t>> levels;
+    start = Clock::now();
+    (void)dictionary->HyphenateBatch(targets, levels);
+    HyphenBreakMasks masks;
+    for (const auto& level : levels) {
+        masks.Append(level, options);
+    }
+    report.hyphenateUs = chrono::duration<double, micro>(Clock::now() - start).count();
+
+    for (size_t i = 0; i < words.size(); i++) {
+        CompareWord(words[i], masks, i, levels[i], report);
+    }
+}
+
+void WriteLanguage(ostream& out, const LanguageReport& report)
+{
+    out << "    {\n      \"language\": \"" << report.language << "\",\n      \"loaded\": " <<
+        (report.loaded ? "true" : "false") << ",\n      \"words\": " << report.words << ",\n      \"checked\": " <<
+        report.checked << ",\n      \"passed\": " << report.passed << ",\n      \"failed\": " <<
+        (report.checked - report.passed) << ",\n      \"missing_breaks\": " << report.missing <<
+        ",\n      \"extra_breaks\": " << report.extra << ",\n      \"load_us\": " << report.loadUs <<
+        ",\n      \"hyphenate_us\": " << report.hyphenateUs << ",\n      \"results\": [";
+    for (size_t i = 0; i < report.entries.size(); i++) {
+        out << (i == 0 ? "\n        " : ",\n        ") << report.entries[i];
+    }
+    out << (report.entries.empty() ? "]\n    }" : "\n      ]\n    }");
+}
+
+int32_t ParseArgs(int argc, char** argv, HyphenBreakOptions& options)
+{
+    int32_t index = 1;
+    for (; index + 1 < argc && argv[index][0] == '-' && argv[index][1] == '-'; index += 2) {
+        string option = argv[index];
+        if (option == "--left") {
+            options.leftMin = static_cast<size_t>(stoul(argv[index + 1]));
+        } else if (option == "--right") {
+            options.rightMin = static_cast<size_t>(stoul(argv[index + 1]));
+        } else {
+            return FAILED;
+        }
+    }
+    return argc - index >= MIN_ARG_NUM - 1 ? index : FAILED;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // exceptions are stored as complete words, by default compare the breaks as they are
+    HyphenBreakOptions options{1, 1};
+    int32_t index = ParseArgs(argc, argv, options);
+    if (index == FAILED) {
+        cout << "usage: './hyphen_regression [--left N] [--right N] <hpb_dir> <report.json> <list>...'" << endl;
+        return FAILED;
+    }
+    const string hpbDir = argv[index];
+    const string reportPath = argv[index + 1];
+
+    vector<LanguageReport> reports;
+    size_t checked = 0;
+    size_t passed = 0;
+    double totalUs = 0;
+    size_t totalWords = 0;
+    for (int32_t i = index + 2; i < argc; i++) {
+        string fileName = argv[i];
+        fileName = fileName.substr(fileName.find_last_of("/\\") + 1);
+        vector<TestWord> words;
+        if (ReadList(argv[i], words) != SUCCEED) {
+            return FAILED;
+        }
+        LanguageReport report;
+        report.language = fileName.substr(0, fileName.find('.'));
+        RunLanguage(hpbDir, words, options, report);
+        cout << report.language << ": " << report.passed << " / " << report.checked << " golden words passed, " <<
+            report.words << " words in " << report.hyphenateUs << " us" << endl;
+        checked += report.checked;
+        passed += report.passed;
+        totalUs += report.hyphenateUs;
+        totalWords += report.words;
+        reports.push_back(std::move(report));
+    }
+
+    ofstream out(reportPath, ios::trunc);
+    out << "{\n  \"left_min\": " << options.leftMin << ",\n  \"right_min\": " << options.rightMin <<
+        ",\n  \"words\": " << totalWords << ",\n  \"checked\": " << checked << ",\n  \"passed\": " << passed <<
+        ",\n  \"hyphenate_us\": " << totalUs << ",\n  \"languages\": [";
+    for (size_t i = 0; i < reports.size(); i++) {
+        out << (i == 0 ? "\n" : ",\n");
+        WriteLanguage(out, reports[i]);
+    }
+    out << "\n  ]\n}\n";
+    if (!out.good()) {
+        cerr << "failed to write " << reportPath << endl;
+        return FAILED;
+    }
+    cout << passed << " / " << checked << " golden words passed" << endl;
+    return passed == checked ? SUCCEED : FAILED;
+}